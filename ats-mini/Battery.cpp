@@ -62,6 +62,14 @@ float batteryMonitor()
   return(batteryVolts);
 }
 
+//
+// Return last measured battery voltage, without measuring it
+//
+float batteryGetVoltage()
+{
+  return(batteryVolts);
+}
+
 //
 // Show last measured battery voltage and status at given screen
 // coordinates. Return true if voltage was drawn.
@@ -70,8 +78,9 @@ bool drawBattery(int x, int y)
 {
   if(sleepOn()) return false;
 
-  // Measure battery voltage and status
-  batteryMonitor();
+  // Battery is measured by drawScreen(), before drawing
+  uint8_t state = batteryState;
+  float volts = batteryVolts;
 
   // Set display information
   spr.drawRoundRect(x, y + 1, 28, 14, 3, TH.batt_border);
@@ -84,14 +93,14 @@ bool drawBattery(int x, int y)
   if(switchThemeEditor())
   {
     // Alternate between five battery states every 10 seconds
-    batteryState = (millis() % 50000u) / 10000u;
-    batteryVolts = batteryState >= 4 ? 4.5 : 4.0;
+    state = (millis() % 50000u) / 10000u;
+    volts = state >= 4 ? 4.5 : 4.0;
   }
 
   // The hardware has a load sharing circuit to allow simultaneous charge and power
   // With USB(5V) connected the voltage reading will be approx. VBUS - Diode Drop = 4.65V
   // If the average voltage is greater than 4.3V, show ligtning on the display
-  if(batteryVolts > 4.3)
+  if(volts > 4.3)
   {
     spr.fillRoundRect(x + 2, y + 3, 24, 10, 2, TH.batt_charge);
     spr.drawLine(x + 9 + 8, y + 1, x + 9 + 6, y + 1 + 5, TH.bg);
@@ -113,10 +122,10 @@ bool drawBattery(int x, int y)
     int level;
 
     // Text representation of the voltage
-    sprintf(voltage, "%.02fV", batteryVolts);
+    sprintf(voltage, "%.02fV", volts);
 
     // Battery bar color and width
-    switch(batteryState)
+    switch(state)
     {
       case 0:
         color = TH.batt_low;
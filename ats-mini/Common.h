@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <TFT_eSPI.h>
 #include <SI4735-fixed.h>
+#include "Jobs.h"
 
 #define RECEIVER_DESC  "ESP32-SI4732 Receiver"
 #define RECEIVER_NAME  "ATS-Mini"
@@ -168,18 +169,65 @@ static inline bool isSSB() { return(currentMode>FM && currentMode<AM); }
 
 void useBand(const Band *band);
 bool updateBFO(int newBFO, bool wrap = true);
-bool doSeek(int8_t dir);
+bool doSeek(int dir);
 bool clickFreq(bool shortPress);
 uint8_t doAbout(int dir);
 
 // Battery.c
 float batteryMonitor();
+float batteryGetVoltage();
 bool drawBattery(int x, int y);
 
 // Scan.c
-void scanRun(uint16_t centerFreq, uint16_t step);
-float scanGetRSSI(uint16_t freq);
-float scanGetSNR(uint16_t freq);
+typedef struct
+{
+  uint32_t sweeps;        // Scans finished or stopped
+  uint32_t bins;          // Frequencies measured
+  uint32_t dwells;        // Possible carriers measured again
+  uint32_t timeouts;      // Tunings not completed in SCAN_TIME
+  uint32_t time;          // Total scanning time (us)
+} ScanStats;
+
+ScanStats scanGetStats(bool reset = false);
+void scanStart(uint16_t step);
+void scanStop();
+void scanClear();
+bool scanIsRunning();
+bool scanTickTime();
+float scanGetRSSI(uint16_t freq, uint16_t span = 0);
+float scanGetSNR(uint16_t freq, uint16_t span = 0);
+uint8_t scanGetZoom();
+void scanZoom(int dir);
+uint8_t scanGetProgress();
+uint16_t scanGetVersion();
+
+// Events.cpp
+void eventInit();
+void eventSignal();
+void eventSignalFromISR();
+void eventWait(uint32_t msecs);
+void encoderPush(int8_t dir);
+bool encoderPending();
+int encoderDrain(bool accel);
+
+// Radio.cpp
+typedef struct
+{
+  uint8_t rssi;           // Signal strength (dBuV)
+  uint8_t snr;            // Signal to noise ratio (dB)
+  bool pilot;             // FM stereo pilot detected
+  uint16_t capacitor;     // Antenna tuning capacitor
+  bool stale;             // Measured before the last tuning request
+} RadioStatus;
+
+void radioInit();
+void radioLock();
+void radioUnlock();
+void radioTune(uint16_t freq);
+void radioSync();
+void radioWake();
+bool radioRdsReady();
+RadioStatus radioGetStatus();
 
 // Station.c
 const char *getStationName();
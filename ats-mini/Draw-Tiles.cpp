@@ -0,0 +1,74 @@
+#include "Draw-Tiles.h"
+
+#include <string.h>
+
+//
+// Return TRUE if given tile differs from the displayed one
+//
+static bool tileChanged(const uint8_t *buf, const uint8_t *shown, size_t pixel)
+{
+  for(int y=0 ; y<TILE_H ; y++, buf+=320*pixel, shown+=320*pixel)
+    if(memcmp(buf, shown, TILE_W * pixel)) return(true);
+
+  return(false);
+}
+
+//
+// Copy given tile to the displayed screen
+//
+static void tileCopy(const uint8_t *buf, uint8_t *shown, size_t pixel)
+{
+  for(int y=0 ; y<TILE_H ; y++, buf+=320*pixel, shown+=320*pixel)
+    memcpy(shown, buf, TILE_W * pixel);
+}
+
+//
+// Compare ROWS rows of tiles of the screen buffer BUF, starting with
+// row of tiles TOP, to SHOWN, a copy of the whole displayed screen.
+// Both are 320 pixels wide, with PIXEL bytes per pixel. Changed tiles
+// (or all of them if FULL is TRUE or SHOWN is NULL) are copied to SHOWN
+// and passed to PUSH, with rows of tiles having the same columns pushed
+// together. Returns the number of changed tiles.
+//
+int tilesUpdate(const uint8_t *buf, uint8_t *shown, size_t pixel, int top, int rows, bool full, TilePush push)
+{
+  // Changed rows of tiles with the same columns get pushed together
+  int rowX = 0, rowY = 0, rowW = 0, rowH = 0;
+  int changed = 0;
+
+  full = full || !shown;
+
+  for(int ty=top ; ty<top+rows ; ty++)
+  {
+    int first = TILES_X, last = -1;
+
+    for(int tx=0 ; tx<TILES_X ; tx++)
+    {
+      const uint8_t *p = buf + ((ty - top) * TILE_H * 320 + tx * TILE_W) * pixel;
+      uint8_t *s = shown? shown + (ty * TILE_H * 320 + tx * TILE_W) * pixel : 0;
+
+      if(full || tileChanged(p, s, pixel))
+      {
+        if(s) tileCopy(p, s, pixel);
+        first = tx < first? tx : first;
+        last  = tx;
+        changed++;
+      }
+    }
+
+    // Extend pending rectangle if possible, else push it
+    if(rowH && first==rowX && last-first+1==rowW)
+      rowH++;
+    else
+    {
+      if(rowH) push(rowX, rowY, rowW, rowH);
+      rowX = first;
+      rowY = ty;
+      rowW = last - first + 1;
+      rowH = rowW > 0? 1 : 0;
+    }
+  }
+
+  if(rowH) push(rowX, rowY, rowW, rowH);
+  return(changed);
+}
@@ -0,0 +1,23 @@
+#ifndef DRAW_TILES_H
+#define DRAW_TILES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Screen is split into tiles, only changed tiles get pushed to
+// the display
+#define TILE_W   32 // Tile width, pixels
+#ifdef ENABLE_STRIPS
+#define TILE_H   17 // Tile height, pixels (strips are made of tiles)
+#else
+#define TILE_H   10 // Tile height, pixels
+#endif
+#define TILES_X  (320 / TILE_W)
+#define TILES_Y  (170 / TILE_H)
+
+// Push a rectangle of tiles from the screen buffer to the display
+typedef void (*TilePush)(int tx, int ty, int tw, int th);
+
+int tilesUpdate(const uint8_t *buf, uint8_t *shown, size_t pixel, int top, int rows, bool full, TilePush push);
+
+#endif // DRAW_TILES_H
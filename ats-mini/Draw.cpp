@@ -4,13 +4,329 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "Draw-Tiles.h"
+#include "EIBI.h"
+
+#ifdef ENABLE_DMA
+#include <esp_lcd_panel_io.h>
+#include <esp_heap_caps.h>
+#endif
+
+#ifdef ENABLE_8BIT
+// Screen buffer pixel, RGB332 shown via drawPalette[]
+typedef uint8_t Pixel;
+#define PIXEL(c) ((Pixel)spr.color16to8(c))
+#else
+// Screen buffer pixel, byte-swapped RGB565
+typedef uint16_t Pixel;
+#define PIXEL(c) ((Pixel)SWAP16(c))
+#endif
+
+#define SWAP16(c) ((uint16_t)(((c) >> 8) | ((c) << 8)))
+
+#ifdef ENABLE_8BIT
+
+// Byte-swapped RGB565 colors for RGB332 screen buffer pixels
+static uint16_t drawPalette[256];
+
+//
+// Make RGB332 pixels of theme colors show exactly these colors,
+// return TRUE if the palette has changed
+//
+static bool drawUpdatePalette()
+{
+  static uint16_t colors[(sizeof(ColorTheme) - sizeof(const char *)) / 2];
+  static bool valid = false;
+  uint16_t c[ITEM_COUNT(colors)];
+
+  memcpy(c, (const uint8_t *)&TH + sizeof(const char *), sizeof(c));
+  if(valid && !memcmp(c, colors, sizeof(c))) return(false);
+
+  memcpy(colors, c, sizeof(colors));
+  valid = true;
+
+  for(int j=0 ; j<256 ; j++) drawPalette[j] = SWAP16(spr.color8to16(j));
+
+  // Earlier theme colors take precedence
+  for(int j=ITEM_COUNT(c)-1 ; j>=0 ; j--)
+    drawPalette[spr.color16to8(c[j])] = SWAP16(c[j]);
+
+  return(true);
+}
+
+#endif // ENABLE_8BIT
+
+//
+// Return RGB565 color of a screen buffer pixel
+//
+static inline uint16_t pixelColor(Pixel p)
+{
+#ifdef ENABLE_8BIT
+  return(SWAP16(drawPalette[p]));
+#else
+  return(SWAP16(p));
+#endif
+}
+
+#ifdef ENABLE_STRIPS
+// Screen buffer holds one strip, starting at drawTop
+#define BUF_H    STRIP_H
+#else
+#define BUF_H    170
+#endif
+
+static int drawTop = 0;
+
+// EEPROM write indicator state, taken once per screen update so
+// that every strip shows the same
+static bool drawEepromWritten = false;
+
+// Anti-aliased icons are pre-rendered for the current theme colors
+// and blitted into the screen buffer
+typedef struct
+{
+  uint32_t key;           // Colors and shape the icon was drawn with
+  TFT_eSprite *s;         // Icon bitmap, drawn over TH.bg
+  uint8_t *mask;          // Bit set for each pixel covered by the icon
+  uint8_t pass;           // Drawing pass, see iconDraw()
+} Icon;
+
+static inline uint32_t iconHash(uint32_t sum, uint32_t data)
+{
+  return(((sum << 5) + sum) ^ data);
+}
+
+//
+// Get WxH icon bitmap for KEY, return NULL if not possible. If the
+// bitmap has to be drawn, iconDraw() will return TRUE.
+//
+static TFT_eSprite *iconGet(Icon *icon, uint32_t key, int w, int h)
+{
+  if(!spr.getPointer()) return(0);
+  if(!icon->s) icon->s = new TFT_eSprite(&tft);
+
+  // Bitmaps are kept in the screen buffer format
+  TFT_eSprite *s = icon->s;
+  if(s->created() && s->width()==w && s->height()==h && icon->key==key)
+    return(s);
+
+  if(s->created() && (s->width()!=w || s->height()!=h))
+  {
+    s->deleteSprite();
+    free(icon->mask);
+    icon->mask = 0;
+  }
+
+  if(!s->created())
+  {
+    s->setColorDepth(sizeof(Pixel) * 8);
+    if(!s->createSprite(w, h)) return(0);
+  }
+
+  if(!icon->mask)
+  {
+    icon->mask = (uint8_t *)malloc((w * h + 7) / 8);
+    if(!icon->mask) { s->deleteSprite(); return(0); }
+  }
+
+  // Key gets set once drawing is complete
+  icon->key = ~key;
+  icon->pass = 0;
+  return(s);
+}
+
+//
+// Update icon mask with the pixels that differ from background BG
+//
+static void iconCover(Icon *icon, uint16_t bg, bool clear)
+{
+  const Pixel *src = (const Pixel *)icon->s->getPointer();
+  int size = icon->s->width() * icon->s->height();
+  Pixel key = PIXEL(bg);
+
+  if(clear) memset(icon->mask, 0, (size + 7) / 8);
+  for(int i=0 ; i<size ; i++)
+    if(src[i]!=key) icon->mask[i >> 3] |= 1 << (i & 7);
+}
+
+//
+// Icons are drawn twice, over the complement of TH.bg and then over
+// TH.bg itself. Pixels left as background both times are transparent,
+// so icons may contain TH.bg colored pixels. Call in a loop, drawing
+// the icon over *BG, until it returns FALSE.
+//
+static bool iconDraw(Icon *icon, uint32_t key, uint16_t *bg)
+{
+  switch(icon->pass)
+  {
+    case 0:
+      *bg = ~TH.bg;
+      break;
+    case 1:
+      iconCover(icon, ~TH.bg, true);
+      *bg = TH.bg;
+      break;
+    case 2:
+      iconCover(icon, TH.bg, false);
+      icon->key = key;
+      // Fall through
+    default:
+      icon->pass = 3;
+      return(false);
+  }
+
+  icon->s->fillSprite(*bg);
+  icon->pass++;
+  return(true);
+}
+
+//
+// Blit WxH area at SX/SY of icon into the screen buffer at X/Y,
+// skipping the pixels not covered by the icon
+//
+static void iconBlit(const Icon *icon, int x, int y, int sx, int sy, int w, int h)
+{
+  Pixel *buf = (Pixel *)spr.getPointer();
+  int width = icon->s->width();
+  const Pixel *src = (const Pixel *)icon->s->getPointer();
+
+  for(int j=0 ; j<h ; j++)
+  {
+    int py = y + j - drawTop;
+    if(py < 0 || py >= BUF_H) continue;
+
+    Pixel *dst = buf + py * 320;
+    for(int i=0 ; i<w ; i++)
+    {
+      int n = (sy + j) * width + sx + i;
+      if((icon->mask[n >> 3] & (1 << (n & 7))) && x + i >= 0 && x + i < 320)
+        dst[x + i] = src[n];
+    }
+  }
+}
+
+#if DEBUG
+//
+// Every DRAW_CHECK_BOXES boxes, drawSmoothBox() also draws the box
+// with fillSmoothRoundRect() and counts pixels that came out different
+// where the box was drawn over TH.bg
+//
+#define DRAW_CHECK_BOXES 16
+
+#define BOX_SAVE    0 // Copy box area from the screen buffer to DATA
+#define BOX_RESTORE 1 // Copy box area from DATA to the screen buffer
+#define BOX_COMPARE 2 // Compare box area with the reference in DATA
+
+static uint32_t drawBadPixels = 0;
+
+//
+// DATA holds the reference box, followed by the screen under it
+//
+static void drawCheckBox(int x, int y, int w, int h, Pixel *data, int op)
+{
+  Pixel *buf = (Pixel *)spr.getPointer();
+  const Pixel *under = data + w * h;
+  Pixel bg = PIXEL(TH.bg);
+
+  for(int j=0 ; j<h ; j++)
+  {
+    int py = y + j - drawTop;
+    if(py < 0 || py >= BUF_H) continue;
+
+    for(int i=0 ; i<w ; i++)
+    {
+      if(x + i < 0 || x + i >= 320) continue;
+
+      Pixel *p = buf + py * 320 + x + i;
+      Pixel *d = data + j * w + i;
+      switch(op)
+      {
+        case BOX_SAVE:    *d = *p; break;
+        case BOX_RESTORE: *p = *d; break;
+        case BOX_COMPARE:
+          if(under[j * w + i]==bg && *d!=*p) drawBadPixels++;
+          break;
+      }
+    }
+  }
+}
+#endif // DEBUG
+
+//
+// Draw a filled rectangle with rounded anti-aliased corners and a
+// one pixel BORDER, same as two fillSmoothRoundRect() calls
+//
+void drawSmoothBox(int x, int y, int w, int h, uint16_t border, uint16_t fill)
+{
+  static Icon corners[4] = { 0 };
+  static uint8_t next = 0;
+  uint32_t key = iconHash(iconHash(iconHash(5381, border), fill), TH.bg);
+  TFT_eSprite *s = 0;
+  uint16_t bg;
+  int j;
+
+  // Corners are cut from a small box drawn for the same colors
+  for(j=0 ; j<(int)ITEM_COUNT(corners) && corners[j].key!=key ; j++);
+  if(j>=(int)ITEM_COUNT(corners)) j = next++ % ITEM_COUNT(corners);
+  if(w >= 12 && h >= 12) s = iconGet(&corners[j], key, 12, 12);
+
+  if(!s)
+  {
+    spr.fillSmoothRoundRect(x, y, w, h, 4, border);
+    spr.fillSmoothRoundRect(x + 1, y + 1, w - 2, h - 2, 4, fill);
+    return;
+  }
+
+  while(iconDraw(&corners[j], key, &bg))
+  {
+    s->fillSmoothRoundRect(0, 0, 12, 12, 4, border);
+    s->fillSmoothRoundRect(1, 1, 10, 10, 4, fill);
+  }
+
+#if DEBUG
+  // Draw the reference box, keeping it and the screen under it
+  static uint32_t boxes = 0;
+  Pixel *ref = boxes++ % DRAW_CHECK_BOXES? 0 : (Pixel *)malloc(2 * w * h * sizeof(Pixel));
+  if(ref)
+  {
+    drawCheckBox(x, y, w, h, ref + w * h, BOX_SAVE);
+    spr.fillSmoothRoundRect(x, y, w, h, 4, border);
+    spr.fillSmoothRoundRect(x + 1, y + 1, w - 2, h - 2, 4, fill);
+    drawCheckBox(x, y, w, h, ref, BOX_SAVE);
+    drawCheckBox(x, y, w, h, ref + w * h, BOX_RESTORE);
+  }
+#endif
+
+  // Straight edges and inside
+  spr.drawFastHLine(x + 6, y, w - 12, border);
+  spr.drawFastHLine(x + 6, y + h - 1, w - 12, border);
+  spr.drawFastVLine(x, y + 6, h - 12, border);
+  spr.drawFastVLine(x + w - 1, y + 6, h - 12, border);
+  spr.fillRect(x + 6, y + 1, w - 12, 5, fill);
+  spr.fillRect(x + 1, y + 6, w - 2, h - 12, fill);
+  spr.fillRect(x + 6, y + h - 6, w - 12, 5, fill);
+
+  // Corners
+  iconBlit(&corners[j], x, y, 0, 0, 6, 6);
+  iconBlit(&corners[j], x + w - 6, y, 6, 0, 6, 6);
+  iconBlit(&corners[j], x, y + h - 6, 0, 6, 6, 6);
+  iconBlit(&corners[j], x + w - 6, y + h - 6, 6, 6, 6, 6);
+
+#if DEBUG
+  if(ref)
+  {
+    drawCheckBox(x, y, w, h, ref, BOX_COMPARE);
+    free(ref);
+  }
+#endif
+}
 
 //
 // Draw EEPROM write indicator
 //
 void drawEepromIndicator(int x, int y)
 {
-  if(eepromIsWritten() || switchThemeEditor())
+  if(drawEepromWritten || switchThemeEditor())
   {
     // Draw EEPROM write request icon
     spr.fillRect(x+3, y+2, 3, 5, TH.save_icon);
@@ -55,15 +371,34 @@ void drawWiFiIndicator(int x, int y)
   // If need to draw WiFi icon...
   if(status || switchThemeEditor())
   {
+    static Icon icons[2] = { 0 };
     uint16_t color = (status>0) ? TH.rf_icon_conn : TH.rf_icon;
 
     // For the editor, alternate between WiFi states every ~8 seconds
     if(switchThemeEditor())
       color = millis()&0x2000? TH.rf_icon_conn : TH.rf_icon;
 
-    spr.drawSmoothArc(x, 15+y, 14, 13, 150, 210, color, TH.bg);
-    spr.drawSmoothArc(x, 15+y, 9, 8, 150, 210, color, TH.bg);
-    spr.drawSmoothArc(x, 15+y, 4, 3, 150, 210, color, TH.bg);
+    uint16_t bg;
+    uint32_t key = iconHash(iconHash(5381, color), TH.bg);
+    Icon *icon = &icons[color==TH.rf_icon_conn? 1 : 0];
+    TFT_eSprite *s = iconGet(icon, key, 30, 17);
+
+    if(!s)
+    {
+      spr.drawSmoothArc(x, 15+y, 14, 13, 150, 210, color, TH.bg);
+      spr.drawSmoothArc(x, 15+y, 9, 8, 150, 210, color, TH.bg);
+      spr.drawSmoothArc(x, 15+y, 4, 3, 150, 210, color, TH.bg);
+      return;
+    }
+
+    while(iconDraw(icon, key, &bg))
+    {
+      s->drawSmoothArc(15, 15, 14, 13, 150, 210, color, bg);
+      s->drawSmoothArc(15, 15, 9, 8, 150, 210, color, bg);
+      s->drawSmoothArc(15, 15, 4, 3, 150, 210, color, bg);
+    }
+
+    iconBlit(icon, x - 15, y, 0, 0, 30, 17);
   }
 }
 
@@ -99,19 +434,390 @@ void drawZoomedMenu(const char *text)
   spr.drawSmoothRoundRect(RDS_OFFSET_X - 70, RDS_OFFSET_Y - 3, 4, 4, 150, 28, TH.menu_border, TH.menu_bg);
 }
 
+// Copy of the displayed screen, changed tiles are found by comparing
+// the screen buffer to it. Strips mode has no room for it and pushes
+// everything, as do other modes if there is not enough memory.
+static Pixel *drawShown = 0;
+static bool drawShownFailed = false;
+static bool drawShownValid = false;
+
+#ifdef ENABLE_DMA
+
+// Pushing screen updates with the LCD peripheral DMA, in background
+#define DMA_PCLK_HZ    10000000 // Display write clock
+
+// Display RAM offsets, same as TFT_eSPI uses. With CGRAM_OFFSET, panels
+// smaller than the 240x320 ST7789 RAM are centered in it, and the
+// screen is rotated to landscape.
+#if defined(ST7789_DRIVER) && defined(CGRAM_OFFSET)
+#if (240 - TFT_WIDTH) % 2 || (320 - TFT_HEIGHT) % 2
+#error "Display RAM offsets depend on rotation, set them for this panel"
+#endif
+#define DMA_X_OFFSET   ((320 - TFT_HEIGHT) / 2)
+#define DMA_Y_OFFSET   ((240 - TFT_WIDTH) / 2)
+#else
+#define DMA_X_OFFSET   0
+#define DMA_Y_OFFSET   0
+#endif
+
+static esp_lcd_i80_bus_handle_t dmaBus = 0;
+static esp_lcd_panel_io_handle_t dmaIO = 0;
+static SemaphoreHandle_t dmaDone = 0;
+static uint16_t *dmaBuf = 0;
+static bool dmaFailed = false;
+
+// Changed area of the screen, in tiles
+static int dmaX0, dmaY0, dmaX1, dmaY1;
+
+static bool dmaTransferDone(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *data, void *ctx)
+{
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(dmaDone, &woken);
+  return(woken == pdTRUE);
+}
+
 //
-// Show overlay message in large letters
+// Switch display bus from TFT_eSPI to the LCD peripheral, return
+// FALSE if not possible (i.e. out of DMA capable memory)
 //
-void drawMessage(const char *msg)
+static bool dmaInit()
 {
-  if(sleepOn()) return;
+  if(dmaIO) return(true);
+  if(dmaFailed) return(false);
+
+  // Frame buffer the DMA reads from while the sprite is redrawn. It
+  // takes 106KB of internal RAM (21KB in the strips mode), always with
+  // 16-bit pixels, as the display takes them.
+  dmaBuf  = (uint16_t *)heap_caps_malloc(320 * BUF_H * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  dmaDone = xSemaphoreCreateBinary();
+  if(!dmaBuf || !dmaDone) goto fail;
+
+  {
+    const int pins[8] = { TFT_D0, TFT_D1, TFT_D2, TFT_D3, TFT_D4, TFT_D5, TFT_D6, TFT_D7 };
+    esp_lcd_i80_bus_config_t bus = {};
+    bus.dc_gpio_num = TFT_DC;
+    bus.wr_gpio_num = TFT_WR;
+    bus.clk_src = LCD_CLK_SRC_DEFAULT;
+    for(int j=0 ; j<8 ; j++) bus.data_gpio_nums[j] = pins[j];
+    bus.bus_width = 8;
+    bus.max_transfer_bytes = 320 * BUF_H * 2;
+    if(esp_lcd_new_i80_bus(&bus, &dmaBus) != ESP_OK) goto fail;
+
+    esp_lcd_panel_io_i80_config_t io = {};
+    io.cs_gpio_num = TFT_CS;
+    io.pclk_hz = DMA_PCLK_HZ;
+    io.trans_queue_depth = 4;
+    io.on_color_trans_done = dmaTransferDone;
+    io.lcd_cmd_bits = 8;
+    io.lcd_param_bits = 8;
+    io.dc_levels.dc_data_level = 1;
+    if(esp_lcd_new_panel_io_i80(dmaBus, &io, &dmaIO) != ESP_OK) goto fail;
+  }
+
+  // Nothing is being transferred yet
+  xSemaphoreGive(dmaDone);
+  return(true);
+
+fail:
+  if(dmaBus) esp_lcd_del_i80_bus(dmaBus);
+  if(dmaDone) vSemaphoreDelete(dmaDone);
+  if(dmaBuf) heap_caps_free(dmaBuf);
+  dmaBus = 0;
+  dmaDone = 0;
+  dmaBuf = 0;
+  dmaFailed = true;
+  return(false);
+}
+
+//
+// Copy changed area to the DMA buffer and start pushing it to the
+// display, without waiting for the transfer to complete
+//
+static void dmaPush()
+{
+  int x = dmaX0 * TILE_W, w = (dmaX1 - dmaX0 + 1) * TILE_W;
+  int y = dmaY0 * TILE_H, h = (dmaY1 - dmaY0 + 1) * TILE_H;
+
+  // Wait for the previous transfer to finish with the buffer
+  xSemaphoreTake(dmaDone, portMAX_DELAY);
+
+  const Pixel *src = (const Pixel *)spr.getPointer() + (y - drawTop) * 320 + x;
+#ifdef ENABLE_8BIT
+  for(int j=0 ; j<h ; j++)
+    for(int i=0 ; i<w ; i++) dmaBuf[j * w + i] = drawPalette[src[j * 320 + i]];
+#else
+  for(int j=0 ; j<h ; j++) memcpy(dmaBuf + j * w, src + j * 320, w * 2);
+#endif
+
+  int x0 = x + DMA_X_OFFSET, x1 = x0 + w - 1;
+  int y0 = y + DMA_Y_OFFSET, y1 = y0 + h - 1;
+  uint8_t cols[4] = { (uint8_t)(x0 >> 8), (uint8_t)x0, (uint8_t)(x1 >> 8), (uint8_t)x1 };
+  uint8_t rows[4] = { (uint8_t)(y0 >> 8), (uint8_t)y0, (uint8_t)(y1 >> 8), (uint8_t)y1 };
+
+  esp_lcd_panel_io_tx_param(dmaIO, ST7789_CASET, cols, 4);
+  esp_lcd_panel_io_tx_param(dmaIO, ST7789_RASET, rows, 4);
+  esp_lcd_panel_io_tx_color(dmaIO, ST7789_RAMWR, dmaBuf, w * h * 2);
+}
+
+#endif // ENABLE_DMA
+
+//
+// Send a command to the display, after any pending screen update
+//
+void drawCommand(uint8_t cmd)
+{
+#ifdef ENABLE_DMA
+  if(dmaIO)
+  {
+    xSemaphoreTake(dmaDone, portMAX_DELAY);
+    esp_lcd_panel_io_tx_param(dmaIO, cmd, 0, 0);
+    xSemaphoreGive(dmaDone);
+    return;
+  }
+#endif
+
+  tft.writecommand(cmd);
+}
+
+//
+// Push a rectangle of tiles from the screen buffer to the display
+//
+static void drawPushTiles(int tx, int ty, int tw, int th)
+{
+  if(tw <= 0 || th <= 0) return;
+
+#ifdef ENABLE_DMA
+  // Collect changed area to be pushed at once
+  if(dmaIO)
+  {
+    dmaX0 = tx < dmaX0? tx : dmaX0;
+    dmaY0 = ty < dmaY0? ty : dmaY0;
+    dmaX1 = tx + tw - 1 > dmaX1? tx + tw - 1 : dmaX1;
+    dmaY1 = ty + th - 1 > dmaY1? ty + th - 1 : dmaY1;
+    return;
+  }
+#endif
+
+#ifdef ENABLE_8BIT
+  // Expand pixels through the palette, line by line
+  int x = tx * TILE_W, w = tw * TILE_W;
+  int y = ty * TILE_H, h = th * TILE_H;
+  const Pixel *src = (const Pixel *)spr.getPointer() + (y - drawTop) * 320 + x;
+  bool swap = tft.getSwapBytes();
+  uint16_t line[320];
+
+  tft.setSwapBytes(false);
+  tft.startWrite();
+  tft.setAddrWindow(x, y, w, h);
+  for(int j=0 ; j<h ; j++, src+=320)
+  {
+    for(int i=0 ; i<w ; i++) line[i] = drawPalette[src[i]];
+    tft.pushPixels(line, w);
+  }
+  tft.endWrite();
+  tft.setSwapBytes(swap);
+#else
+  spr.pushSprite(tx * TILE_W, ty * TILE_H, tx * TILE_W, ty * TILE_H - drawTop, tw * TILE_W, th * TILE_H);
+#endif
+}
+
+//
+// Push changed parts of the screen buffer to the display, or
+// everything if FULL is TRUE
+//
+void drawPush(bool full)
+{
+  const uint8_t *buf = (const uint8_t *)spr.getPointer();
+
+  // No direct buffer access, push everything
+  if(!buf)
+  {
+    spr.pushSprite(0, drawTop);
+    return;
+  }
+
+#ifdef ENABLE_8BIT
+  // Theme change may change colors without changing pixels
+  if(drawUpdatePalette()) drawShownValid = false;
+#endif
+
+#ifndef ENABLE_STRIPS
+  // Display copy starts with the first push, which is a full one
+  if(!drawShown && !drawShownFailed)
+  {
+    drawShown = (Pixel *)malloc(320 * 170 * sizeof(Pixel));
+    drawShownFailed = !drawShown;
+  }
+#endif
+
+#ifdef ENABLE_DMA
+  // Nothing changed yet
+  if(dmaInit())
+  {
+    dmaX0 = dmaY0 = 0x7FFF;
+    dmaX1 = dmaY1 = -1;
+  }
+#endif
+
+  // Push tiles differing from the displayed ones
+  full = full || !drawShownValid;
+  tilesUpdate(buf, (uint8_t *)drawShown, sizeof(Pixel), drawTop / TILE_H, BUF_H / TILE_H, full, drawPushTiles);
+  drawShownValid = drawShown != 0;
+
+#ifdef ENABLE_DMA
+  if(dmaIO && dmaX1 >= 0) dmaPush();
+#endif
+}
+
+//
+// Capture screen in a run-length encoded binary form, passing it to
+// WRITE in chunks. In delta modes, rows unchanged since the last
+// capture with the same STATE are skipped. With a non-zero LIMIT, at
+// most LIMIT bytes are written, as a delta capture, and rows that do
+// not fit are left for the next capture. Returns FALSE if nothing has
+// been written.
+//
+static uint8_t captureBuf[1024];
+static size_t captureLen;
+static size_t captureTotal;
+static CaptureWrite captureWrite;
+
+static void captureByte(uint8_t data)
+{
+  captureTotal++;
+  captureBuf[captureLen++] = data;
+  if(captureLen >= sizeof(captureBuf))
+  {
+    captureWrite(captureBuf, captureLen);
+    captureLen = 0;
+  }
+}
+
+static void capturePixel(uint16_t pixel)
+{
+  captureByte(pixel & 0xFF);
+  captureByte(pixel >> 8);
+}
+
+bool drawCapture(CaptureState *state, uint8_t mode, CaptureWrite write, size_t limit)
+{
+  uint16_t width  = spr.width();
+  uint16_t height = spr.height();
+  const Pixel *buf = (const Pixel *)spr.getPointer();
+  uint32_t sums[ITEM_COUNT(state->rows)];
+  uint16_t row[320];
+  bool delta = mode!=CAPTURE_FULL && state->valid;
+  bool changed = mode!=CAPTURE_CHANGES;
+
+  if(!buf || width > ITEM_COUNT(row) || height > ITEM_COUNT(sums))
+    return(false);
+
+#ifdef ENABLE_STRIPS
+  // Only a strip of the screen is kept in memory
+  return(false);
+#endif
+
+  // Find changed rows first
+  for(int y=0 ; y<height ; y++)
+  {
+    sums[y] = 5381;
+    for(int x=0 ; x<width ; x++)
+      sums[y] = ((sums[y] << 5) + sums[y]) ^ buf[y * width + x];
+    changed |= !delta || sums[y]!=state->rows[y];
+  }
+
+  if(!changed) return(false);
+
+  // Header: magic, version, flags, width, height
+  captureWrite = write;
+  captureLen = 0;
+  captureTotal = 0;
+  captureByte('A');
+  captureByte('T');
+  captureByte('S');
+  captureByte('C');
+  captureByte(1);
+  captureByte(delta || limit? 1 : 0);
+  capturePixel(width);
+  capturePixel(height);
 
+  // Longest possible row: marker, then pixels as they are
+  size_t rowMax = 1 + width * 2 + (width + 127) / 128;
+
+  for(int y=0 ; y<height ; y++)
+  {
+    // Same row as in the last capture
+    if(delta && sums[y]==state->rows[y])
+    {
+      captureByte(0);
+      continue;
+    }
+
+    // Row does not fit, make sure it is captured next time
+    if(limit && captureTotal + rowMax + height - y > limit)
+    {
+      state->rows[y] = ~sums[y];
+      captureByte(0);
+      continue;
+    }
+
+    state->rows[y] = sums[y];
+    captureByte(1);
+
+    for(int x=0 ; x<width ; x++)
+      row[x] = pixelColor(buf[y * width + x]);
+
+    for(int x=0, n ; x<width ; x+=n)
+    {
+      // Run of up to 128 equal pixels
+      for(n=1 ; x+n<width && n<128 && row[x+n]==row[x] ; n++);
+      if(n > 1)
+      {
+        captureByte(0x80 | (n - 1));
+        capturePixel(row[x]);
+        continue;
+      }
+
+      // Up to 128 pixels as they are, until the next run
+      for(n=1 ; x+n<width && n<128 && (x+n+1>=width || row[x+n]!=row[x+n+1]) ; n++);
+      captureByte(n - 1);
+      for(int j=0 ; j<n ; j++) capturePixel(row[x+j]);
+    }
+  }
+
+  if(captureLen) write(captureBuf, captureLen);
+  captureLen = 0;
+  state->valid = true;
+  return(true);
+}
+
+// Message drawn over the screen, if any
+static const char *drawMsg = 0;
+
+static void drawMessageBox(const char *msg)
+{
   spr.setTextDatum(MC_DATUM);
-  spr.fillSmoothRoundRect(80, 40, 160, 40, 4, TH.text);
-  spr.fillSmoothRoundRect(81, 41, 158, 38, 4, TH.menu_bg);
+  drawSmoothBox(80, 40, 160, 40, TH.text, TH.menu_bg);
   spr.setTextColor(TH.text, TH.menu_bg);
   spr.drawString(msg, 160, 62, 4);
-  spr.pushSprite(0, 0);
+}
+
+//
+// Show overlay message in large letters
+//
+void drawMessage(const char *msg)
+{
+  if(sleepOn()) return;
+
+#ifdef ENABLE_STRIPS
+  // Nothing to draw over, draw the whole screen with the message
+  drawMsg = msg;
+  drawScreen();
+  drawMsg = 0;
+#else
+  drawMessageBox(msg);
+  drawPush();
+#endif
 }
 
 //
@@ -123,11 +829,33 @@ void drawBandAndMode(const char *band, const char *mode, int x, int y)
   spr.setTextColor(TH.band_text, TH.bg);
   uint16_t band_width = spr.drawString(band, x, y);
 
-  spr.setTextDatum(TL_DATUM);
-  spr.setTextColor(TH.mode_text, TH.bg);
-  uint16_t mode_width = spr.drawString(mode, x + band_width / 2 + 12, y + 8, 2);
+  static Icon icon = { 0 };
+  uint32_t key = iconHash(iconHash(iconHash(5381, TH.mode_text), TH.mode_border), TH.bg);
+  for(const char *p = mode ; *p ; p++) key = iconHash(key, *p);
+
+  // Mode text in a rounded box, 4 pixel margins for the corners
+  uint16_t mode_width = spr.textWidth(mode, 2);
+  uint16_t bg;
+  TFT_eSprite *s = iconGet(&icon, key, mode_width + 8 + 9, 17 + 9);
 
-  spr.drawSmoothRoundRect(x + band_width / 2 + 7, y + 7, 4, 4, mode_width + 8, 17, TH.mode_border, TH.bg);
+  if(!s)
+  {
+    spr.setTextDatum(TL_DATUM);
+    spr.setTextColor(TH.mode_text, TH.bg);
+    spr.drawString(mode, x + band_width / 2 + 12, y + 8, 2);
+    spr.drawSmoothRoundRect(x + band_width / 2 + 7, y + 7, 4, 4, mode_width + 8, 17, TH.mode_border, TH.bg);
+    return;
+  }
+
+  while(iconDraw(&icon, key, &bg))
+  {
+    s->setTextDatum(TL_DATUM);
+    s->setTextColor(TH.mode_text, bg);
+    s->drawString(mode, 5, 1, 2);
+    s->drawSmoothRoundRect(0, 0, 4, 4, mode_width + 8, 17, TH.mode_border, bg);
+  }
+
+  iconBlit(&icon, x + band_width / 2 + 7, y + 7, 0, 0, s->width(), s->height());
 }
 
 //
@@ -148,6 +876,184 @@ void drawRadioText(int y, int ymax)
     spr.drawString(getProgramInfo(), 160, y, 2);
 }
 
+// Pre-rendered frequency glyphs, as 1bpp masks
+typedef struct
+{
+  uint8_t adv;            // Advance width
+  uint8_t height;         // Font height
+  int8_t dx, dy;          // Mask offset from the drawing position
+  uint8_t w, h;           // Mask size
+  uint8_t *bits;          // Mask, rows padded to bytes
+} Glyph;
+
+#define GLYPH_CHARS "0123456789."
+
+static Glyph glyphs7[sizeof(GLYPH_CHARS) - 1];
+static Glyph glyphs4[sizeof(GLYPH_CHARS) - 1];
+static Glyph glyphMHz;
+static Glyph glyphKHz;
+
+// Frequency drawing time, for the F serial command
+static uint32_t freqDraws = 0;
+static uint32_t freqTime = 0;
+
+//
+// Render TEXT with given FONT (or free font GFX) and DATUM at OX/OY
+// in a temporary sprite, keeping only its pixels as a mask
+//
+static bool glyphRender(Glyph *g, const char *text, uint8_t font, const GFXfont *gfx, uint8_t datum, int ox, int oy, int w, int h)
+{
+  TFT_eSprite tmp(&tft);
+  int x0 = w, y0 = h, x1 = -1, y1 = -1;
+
+  if(!tmp.createSprite(w, h)) return(false);
+
+  tmp.fillSprite(0);
+  tmp.setTextColor(0xFFFF);
+  tmp.setTextDatum(datum);
+  if(gfx) tmp.setFreeFont(gfx);
+  tmp.drawString(text, ox, oy, font);
+
+  // Find rendered pixels
+  for(int y=0 ; y<h ; y++)
+    for(int x=0 ; x<w ; x++)
+      if(tmp.readPixel(x, y))
+      {
+        x0 = x < x0? x : x0;
+        x1 = x > x1? x : x1;
+        y0 = y < y0? y : y0;
+        y1 = y > y1? y : y1;
+      }
+
+  g->adv    = tmp.textWidth(text, font);
+  g->height = tmp.fontHeight(font);
+  g->dx     = x1 < 0? 0 : x0 - ox;
+  g->dy     = x1 < 0? 0 : y0 - oy;
+  g->w      = x1 < 0? 0 : x1 - x0 + 1;
+  g->h      = x1 < 0? 0 : y1 - y0 + 1;
+  g->bits   = (uint8_t *)calloc((g->w + 7) / 8 * g->h + 1, 1);
+
+  if(g->bits)
+    for(int y=0 ; y<g->h ; y++)
+      for(int x=0 ; x<g->w ; x++)
+        if(tmp.readPixel(x0 + x, y0 + y))
+          g->bits[y * ((g->w + 7) / 8) + x / 8] |= 0x80 >> (x & 7);
+
+  tmp.deleteSprite();
+  return(!!g->bits);
+}
+
+//
+// Render frequency glyphs once, return FALSE if not possible
+//
+static bool glyphInit()
+{
+  static uint8_t status = 0;
+
+#ifdef DISABLE_GLYPHS
+  // Compare against regular text drawing
+  status = 2;
+#endif
+
+  if(!status)
+  {
+    bool ok = true;
+    char c[2] = { 0, 0 };
+
+    for(int j=0 ; j<(int)ITEM_COUNT(glyphs7) ; j++)
+    {
+      c[0] = GLYPH_CHARS[j];
+      ok = ok && glyphRender(&glyphs7[j], c, 7, 0, TL_DATUM, 0, 0, 64, 64);
+      ok = ok && glyphRender(&glyphs4[j], c, 4, 0, TL_DATUM, 0, 0, 32, 32);
+    }
+
+    ok = ok && glyphRender(&glyphMHz, "MHz", 1, &Orbitron_Light_24, ML_DATUM, 0, 32, 96, 64);
+    ok = ok && glyphRender(&glyphKHz, "kHz", 1, &Orbitron_Light_24, ML_DATUM, 0, 32, 96, 64);
+
+    status = ok && spr.getPointer()? 1 : 2;
+  }
+
+  return(status==1);
+}
+
+//
+// Blit glyph mask into the screen buffer
+//
+static void drawGlyph(const Glyph *g, int x, int y, uint16_t color)
+{
+  Pixel *buf = (Pixel *)spr.getPointer();
+  Pixel pixel = PIXEL(color);
+  int stride = (g->w + 7) / 8;
+
+  for(int j=0 ; j<g->h ; j++)
+  {
+    int py = y + g->dy + j - drawTop;
+    if(py < 0 || py >= BUF_H) continue;
+
+    const uint8_t *row = g->bits + j * stride;
+    Pixel *dst = buf + py * 320;
+
+    for(int i=0 ; i<g->w ; i++)
+    {
+      int px = x + g->dx + i;
+      if((row[i >> 3] & (0x80 >> (i & 7))) && px >= 0 && px < 320)
+        dst[px] = pixel;
+    }
+  }
+}
+
+//
+// Draw frequency digits in font 7 or 4 the same way drawString()
+// would, using pre-rendered glyphs
+//
+static void drawDigits(const char *text, uint8_t font, int x, int y, uint8_t datum, uint16_t color)
+{
+  Glyph *glyphs = font==7? glyphs7 : glyphs4;
+  const char *p;
+  int w = 0;
+
+  // Fall back to regular text drawing if missing glyphs
+  for(p=text ; *p && strchr(GLYPH_CHARS, *p) ; p++)
+    w += glyphs[strchr(GLYPH_CHARS, *p) - GLYPH_CHARS].adv;
+
+  if(*p || !glyphInit())
+  {
+    spr.setTextDatum(datum);
+    spr.setTextColor(color, TH.bg);
+    spr.drawString(text, x, y, font);
+    return;
+  }
+
+  x -= datum==MR_DATUM? w : 0;
+  y -= glyphs[0].height / 2;
+
+  for(p=text ; *p ; p++)
+  {
+    const Glyph *g = &glyphs[strchr(GLYPH_CHARS, *p) - GLYPH_CHARS];
+
+    // Fonts 4 and 7 fill character background
+    spr.fillRect(x, y, g->adv, g->height, TH.bg);
+    drawGlyph(g, x, y, color);
+    x += g->adv;
+  }
+}
+
+//
+// Draw frequency unit using pre-rendered glyph
+//
+static void drawUnit(const Glyph *g, const char *text, int x, int y)
+{
+  if(glyphInit())
+    drawGlyph(g, x, y, TH.funit_text);
+  else
+  {
+    spr.setFreeFont(&Orbitron_Light_24);
+    spr.setTextDatum(ML_DATUM);
+    spr.setTextColor(TH.funit_text, TH.bg);
+    spr.drawString(text, x, y);
+  }
+}
+
 //
 // Draw frequency
 //
@@ -187,6 +1093,8 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
     { x - 30 - 32 * 4 -  0, y + 28, 27 }, //      10000.000
   };
 
+  uint32_t start = micros();
+
   // Top bit specifies if the digit selector is on
   bool selectOn = hl & 0x80;
   const struct Line *li;
@@ -194,8 +1102,7 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
   // Lower 7 bits specify the selected digit
   hl &= 0x7F;
 
-  spr.setTextDatum(MR_DATUM);
-  spr.setTextColor(TH.freq_text, TH.bg);
+  char text[32];
 
   if(currentMode==FM)
   {
@@ -203,10 +1110,9 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
     li = hl<ITEM_COUNT(hlDigitsFM)? &hlDigitsFM[hl] : 0;
 
     // FM frequency
-    spr.drawFloat(freq/100.00, 2, x, y, 7);
-    spr.setTextDatum(ML_DATUM);
-    spr.setTextColor(TH.funit_text, TH.bg);
-    spr.drawString("MHz", ux, uy);
+    sprintf(text, "%lu.%2.2lu", freq / 100, freq % 100);
+    drawDigits(text, 7, x, y, MR_DATUM, TH.freq_text);
+    drawUnit(&glyphMHz, "MHz", ux, uy);
   }
   else
   {
@@ -216,25 +1122,22 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
     if(isSSB())
     {
       // SSB frequency
-      char text[32];
       freq = freq * 1000 + currentBFO;
       sprintf(text, "%3.3lu", freq / 1000);
-      spr.drawString(text, x, y, 7);
-      spr.setTextDatum(ML_DATUM);
+      drawDigits(text, 7, x, y, MR_DATUM, TH.freq_text);
       sprintf(text, ".%3.3lu", freq % 1000);
-      spr.drawString(text, 4+x, 17+y, 4);
+      drawDigits(text, 4, 4+x, 17+y, ML_DATUM, TH.freq_text);
     }
     else
     {
       // AM frequency
-      spr.drawNumber(freq, x, y, 7);
-      spr.setTextDatum(ML_DATUM);
-      spr.drawString(".000", 4+x, 17+y, 4);
+      sprintf(text, "%lu", freq);
+      drawDigits(text, 7, x, y, MR_DATUM, TH.freq_text);
+      drawDigits(".000", 4, 4+x, 17+y, ML_DATUM, TH.freq_text);
     }
 
     // SSB/AM frequencies are measured in kHz
-    spr.setTextColor(TH.funit_text, TH.bg);
-    spr.drawString("kHz", ux, uy);
+    drawUnit(&glyphKHz, "kHz", ux, uy);
   }
 
   // If drawing an underscore...
@@ -251,66 +1154,185 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
       spr.fillRoundRect(li->x, li->y - 1, li->w, 3, 1, TH.freq_hl);
     }
   }
-}
 
-//
-// Draw tuner scale
-//
-void drawScale(uint32_t freq)
-{
-  spr.fillTriangle(156, 120, 160, 130, 164, 120, TH.scale_pointer);
-  spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
+  freqDraws++;
+  freqTime += micros() - start;
+}
 
-  spr.setTextDatum(MC_DATUM);
-  spr.setTextColor(TH.scale_text, TH.bg);
+// Scale is pre-rendered into a strip wider than the screen, and
+// tuning just blits it at a different offset
+#define SCALE_TICKS  64                // Scale divisions in the strip
+#define SCALE_M      48                // Extra pixels on each side, wider than a label
+#define SCALE_W      (SCALE_TICKS * 8 + 2 * SCALE_M)
+#define SCALE_Y      132               // Strip top on screen
+#define SCALE_H      (170 - SCALE_Y)
+#define SCALE_TEXT_H (150 - SCALE_Y)   // Label rows at the strip top
 
-  // Scale offset
-  int16_t offset = (freq % 10) / 10.0 * 8;
+typedef struct
+{
+  int32_t base;           // First division in the strip
+  uint32_t tick;          // Frequency per division
+  const Band *band;       // Band the scale is drawn for
+  bool fm;                // TRUE: FM labels
+  uint16_t scan;          // Scan data version
+  uint16_t colors[5];     // Theme colors used
+} ScaleKey;
 
-  // Start drawing frequencies from the left
-  freq = freq / 10 - 20;
+static TFT_eSprite scaleSpr(&tft);
+static ScaleKey scaleKey;
 
+//
+// Draw COUNT scale divisions, starting with FIRST at X, to sprite S
+// with vertical offset DY. Division HL is highlighted.
+//
+static void drawScaleTicks(TFT_eSprite &s, int x, int dy, int32_t first, int count, uint32_t tick, int hl)
+{
   // Get band edges
   const Band *band = getCurrentBand();
-  uint32_t minFreq = band->minimumFreq / 10;
-  uint32_t maxFreq = band->maximumFreq / 10;
+  int32_t minFreq = band->minimumFreq / tick;
+  int32_t maxFreq = band->maximumFreq / tick;
+
+  s.setTextDatum(MC_DATUM);
+  s.setTextColor(TH.scale_text, TH.bg);
 
-  for(int i=0 ; i<41 ; i++, freq++)
+  for(int i=0 ; i<count ; i++, x+=8)
   {
-    int16_t x = i * 8 - offset;
+    int32_t freq = first + i;
     if(freq >= minFreq && freq <= maxFreq)
     {
-      uint16_t lineColor = (i==20) && (!offset || (!(freq%5) && offset==1))?
-        TH.scale_pointer : TH.scale_line;
+      uint16_t lineColor = i==hl? TH.scale_pointer : TH.scale_line;
 
       if((freq % 10) == 0)
       {
-        spr.drawLine(x, 169, x, 150, lineColor);
-        spr.drawLine(x + 1, 169, x + 1, 150, lineColor);
+        s.drawLine(x, dy + 169, x, dy + 150, lineColor);
+        s.drawLine(x + 1, dy + 169, x + 1, dy + 150, lineColor);
         if(currentMode == FM)
-          spr.drawFloat(freq / 10.0, 1, x, 140, 2);
-        else if(freq >= 100)
-          spr.drawFloat(freq / 100.0, 3, x, 140, 2);
+          s.drawFloat(freq * tick / 100.0, 1, x, dy + 140, 2);
+        else if(freq * tick >= 1000)
+          s.drawFloat(freq * tick / 1000.0, 3, x, dy + 140, 2);
         else
-          spr.drawNumber(freq * 10, x, 140, 2);
+          s.drawNumber(freq * tick, x, dy + 140, 2);
       }
       else if((freq % 5) == 0 && (freq % 10) != 0)
       {
-        spr.drawLine(x, 169, x, 155, lineColor);
-        spr.drawLine(x + 1, 169, x + 1, 155, lineColor);
+        s.drawLine(x, dy + 169, x, dy + 155, lineColor);
+        s.drawLine(x + 1, dy + 169, x + 1, dy + 155, lineColor);
       }
       else
       {
-        spr.drawLine(x, 169, x, 160, lineColor);
+        s.drawLine(x, dy + 169, x, dy + 160, lineColor);
       }
 
-      int rssi = 20 * scanGetRSSI(freq * 10);
+      int rssi = 20 * scanGetRSSI(freq * tick, tick);
       if(rssi > 0)
-        spr.fillRect(x-1, 170-rssi, 3, rssi, rssi>15? TH.smeter_bar_plus:TH.smeter_bar);
+        s.fillRect(x-1, dy + 170-rssi, 3, rssi, rssi>15? TH.smeter_bar_plus:TH.smeter_bar);
     }
   }
 }
 
+//
+// Blit pre-rendered scale starting with division FIRST, shifted left
+// by OFFSET pixels, return FALSE if not possible
+//
+static bool drawScaleCached(int32_t first, int offset, uint32_t tick)
+{
+  ScaleKey key;
+  Pixel *dst = (Pixel *)spr.getPointer();
+
+#ifdef ENABLE_STRIPS
+  // Scale strip would take more memory than the screen buffer
+  return(false);
+#endif
+
+  if(!dst) return(false);
+  if(!scaleSpr.created())
+  {
+    scaleSpr.setColorDepth(sizeof(Pixel) * 8);
+    if(!scaleSpr.createSprite(SCALE_W, SCALE_H)) return(false);
+  }
+
+  // Keep the current strip if it covers requested divisions
+  memset(&key, 0, sizeof(key));
+  key.base = scaleKey.base;
+  if(first < key.base || first - key.base > (SCALE_W - 2 * SCALE_M - 320) / 8)
+    key.base = first - (SCALE_TICKS - 41) / 2;
+
+  key.tick      = tick;
+  key.band      = getCurrentBand();
+  key.fm        = currentMode == FM;
+  key.scan      = scanGetVersion();
+  key.colors[0] = TH.bg;
+  key.colors[1] = TH.scale_line;
+  key.colors[2] = TH.scale_text;
+  key.colors[3] = TH.smeter_bar;
+  key.colors[4] = TH.smeter_bar_plus;
+
+  // Render the strip again if anything has changed
+  if(memcmp(&key, &scaleKey, sizeof(key)))
+  {
+    memcpy(&scaleKey, &key, sizeof(key));
+    scaleSpr.fillSprite(TH.bg);
+    drawScaleTicks(scaleSpr, 0, -SCALE_Y, key.base - SCALE_M / 8, SCALE_TICKS + 2 * SCALE_M / 8, tick, -1);
+  }
+
+  // The strip has labels for divisions off the screen too. Only show
+  // labels for the 41 divisions on the screen, as drawScaleTicks()
+  // would. Labels are 10 divisions (80 pixels) apart, so each pixel
+  // belongs to the label of the closest labeled division.
+  int label0 = (10 - ((first % 10) + 10) % 10) % 10;
+  int label1 = label0 + (40 - label0) / 10 * 10;
+  int textX0 = label0 * 8 - offset - 40;
+  int textX1 = label1 * 8 - offset + 40;
+  textX0 = textX0 < 0? 0 : textX0;
+  textX1 = textX1 > 320? 320 : textX1;
+
+  // Copy everything but the background
+  const Pixel *src = (const Pixel *)scaleSpr.getPointer() + (first - key.base) * 8 + SCALE_M + offset;
+  Pixel bg = PIXEL(TH.bg);
+
+  dst += SCALE_Y * 320;
+  for(int y=0 ; y<SCALE_H ; y++, src+=SCALE_W, dst+=320)
+  {
+    int x0 = y < SCALE_TEXT_H? textX0 : 0;
+    int x1 = y < SCALE_TEXT_H? textX1 : 320;
+    for(int x=x0 ; x<x1 ; x++)
+      if(src[x] != bg) dst[x] = src[x];
+  }
+
+  return(true);
+}
+
+//
+// Draw tuner scale
+//
+void drawScale(uint32_t freq)
+{
+  // Scale division, zoomed out as requested
+  uint32_t tick = 10 * scanGetZoom();
+
+  // Scale offset
+  int16_t offset = (freq % tick) * 8 / tick;
+
+  // Start drawing frequencies from the left
+  int32_t first = freq / tick - 20;
+
+  // Highlight the division under the pointer
+  int hl = !offset || (!((first + 20) % 5) && offset==1)? 20 : -1;
+
+  if(!drawScaleCached(first, offset, tick))
+  {
+    spr.fillTriangle(156, 120, 160, 130, 164, 120, TH.scale_pointer);
+    spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
+    drawScaleTicks(spr, -offset, 0, first, 41, tick, hl);
+    return;
+  }
+
+  // Highlighted division and the pointer go over the blitted strip
+  if(hl >= 0) drawScaleTicks(spr, 20 * 8 - offset, 0, first + 20, 1, tick, 0);
+  spr.fillTriangle(156, 120, 160, 130, 164, 120, TH.scale_pointer);
+  spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
+}
+
 //
 // Draw S-meter
 //
@@ -376,41 +1398,142 @@ void drawLongStationName(const char *name, int x, int y)
   }
 }
 
+#define FRAME_TIME  33 // Minimal msecs between scheduled screen updates
+
+static DrawStats drawStats = { 0 };
+static uint32_t drawTime = 0;
+static bool drawPending = false;
+
 //
-// Draw screen according to given command
+// Return screen drawing statistics, optionally starting over
 //
-void drawScreen(const char *statusLine1, const char *statusLine2)
+DrawStats drawGetStats(bool reset)
 {
-  if(sleepOn()) return;
+  DrawStats result = drawStats;
+  if(reset) drawStats = (DrawStats){ 0 };
+
+  result.freqDraws = freqDraws;
+  result.freqTime  = freqTime;
+  if(reset) freqDraws = freqTime = 0;
+
+#if DEBUG
+  result.boxes = drawBadPixels;
+  if(reset) drawBadPixels = 0;
+#endif
+
+  return(result);
+}
+
+//
+// Called from the main loop to schedule a screen update. Requests
+// are coalesced and drawn at most once per FRAME_TIME. While BUSY
+// handling user input, drawing is postponed for up to another
+// FRAME_TIME so that the input gets applied first. Returns TRUE
+// if an update is still pending.
+//
+bool drawTickTime(bool needRedraw, bool busy)
+{
+  uint32_t elapsed = millis() - drawTime;
+
+  if(needRedraw)
+  {
+    // Merging this request with an already pending one
+    if(drawPending) drawStats.dropped++;
+    drawPending = true;
+  }
+
+  if(!drawPending || (elapsed < FRAME_TIME) || (busy && elapsed < 2 * FRAME_TIME))
+    return(drawPending);
+
+  drawPending = false;
+  drawTime = millis();
+  drawScreen();
+  return(false);
+}
+
+//
+// Clear screen buffer, draw screen with DRAW(ARG) and push it to
+// the display if PUSH is TRUE. In strip mode, the screen is drawn
+// and pushed one strip at a time.
+//
+void drawFrame(void (*draw)(uint8_t), uint8_t arg, bool push)
+{
+#ifdef ENABLE_STRIPS
+  // Nothing to keep until the next update
+  if(!push) return;
 
-  // Clear screen buffer
+  for(drawTop=0 ; drawTop<170 ; drawTop+=BUF_H)
+  {
+    // Draw the whole screen, keeping only the current strip
+    spr.fillSprite(TH.bg);
+    spr.setViewport(0, -drawTop, 320, 170);
+    draw(arg);
+    spr.resetViewport();
+    drawPush();
+  }
+
+  drawTop = 0;
+#else
   spr.fillSprite(TH.bg);
+  draw(arg);
+  if(push) drawPush();
+#endif
+}
+
+// Status lines passed to drawScreen()
+static const char *drawStatus1;
+static const char *drawStatus2;
 
+static void drawLayout(uint8_t arg)
+{
   // About screen is a special case
   if(currentCmd==CMD_ABOUT)
-  {
     drawAbout();
-    return;
-  }
-
-  switch(uiLayoutIdx)
+  else switch(uiLayoutIdx)
   {
     case UI_SMETER:
-      drawLayoutSmeter(statusLine1, statusLine2);
+      drawLayoutSmeter(drawStatus1, drawStatus2);
       break;
     default:
-      drawLayoutDefault(statusLine1, statusLine2);
+      drawLayoutDefault(drawStatus1, drawStatus2);
       break;
   }
 
+  if(drawMsg) drawMessageBox(drawMsg);
+}
+
+//
+// Draw screen according to given command
+//
+void drawScreen(const char *statusLine1, const char *statusLine2)
+{
+  if(sleepOn()) return;
+
+  uint32_t startTime = micros();
+
+  // Show schedule loading progress unless showing something else
+  if(!statusLine1 && !statusLine2)
+    eibiLoadStatus(&statusLine1, &statusLine2);
+
+  drawStatus1 = statusLine1;
+  drawStatus2 = statusLine2;
+
+  // Take changing state before drawing, the layout may be drawn
+  // several times (once per strip) and must not change anything
+  drawEepromWritten = eepromIsWritten();
+  batteryMonitor();
+
 #ifdef ENABLE_HOLDOFF
-  // Update if not tuning
-  if(!tuning_flag)
-  {
-    spr.pushSprite(0, 0);
-  }
+  // Update if not tuning, About screen is always updated
+  drawFrame(drawLayout, 0, currentCmd==CMD_ABOUT || !tuning_flag);
 #else
   // No hold off
-  spr.pushSprite(0, 0);
+  drawFrame(drawLayout, 0);
 #endif
+
+  // Collect statistics
+  uint32_t frameTime = micros() - startTime;
+  drawStats.frames++;
+  drawStats.total += frameTime;
+  drawStats.longest = frameTime > drawStats.longest? frameTime : drawStats.longest;
 }
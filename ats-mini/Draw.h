@@ -32,8 +32,43 @@
 #define BLE_OFFSET_X   104    // BLE x offset
 #define BLE_OFFSET_Y     0    // BLE y offset
 
+#ifdef ENABLE_STRIPS
+#define STRIP_H         34    // Screen is drawn in strips this high
+#endif
+
+typedef struct
+{
+  uint32_t frames;        // Number of screen updates
+  uint32_t dropped;       // Update requests merged into other updates
+  uint32_t total;         // Total screen update time (us)
+  uint32_t longest;       // Longest screen update time (us)
+  uint32_t boxes;         // Wrong box pixels found (DEBUG builds)
+  uint32_t freqDraws;     // Number of frequency draws
+  uint32_t freqTime;      // Total frequency drawing time (us)
+} DrawStats;
+
+DrawStats drawGetStats(bool reset = false);
+bool drawTickTime(bool needRedraw, bool busy);
+// See tools/screenshot.py for the capture format
+typedef struct
+{
+  uint32_t rows[170];     // Row checksums at the last capture
+  bool valid;             // TRUE: rows[] are valid
+} CaptureState;
+
+typedef void (*CaptureWrite)(const uint8_t *data, size_t size);
+
+#define CAPTURE_FULL    0 // Capture the whole screen
+#define CAPTURE_DELTA   1 // Capture rows changed since the last capture
+#define CAPTURE_CHANGES 2 // Same as CAPTURE_DELTA, nothing if no changes
+
+bool drawCapture(CaptureState *state, uint8_t mode, CaptureWrite write, size_t limit = 0);
+void drawPush(bool full = false);
+void drawCommand(uint8_t cmd);
 void drawMessage(const char *msg);
+void drawFrame(void (*draw)(uint8_t), uint8_t arg, bool push = true);
 void drawZoomedMenu(const char *text);
+void drawSmoothBox(int x, int y, int w, int h, uint16_t border, uint16_t fill);
 void drawScreen(const char *statusLine1 = 0, const char *statusLine2 = 0);
 
 void drawWiFiIndicator(int x, int y);
@@ -0,0 +1,265 @@
+#include "EIBI-Format.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+char replace_accented_char(char c)
+{
+  switch((unsigned char)c)
+  {
+    // Lowercase vowels with accents
+    case 0xE1: case 0xE0: case 0xE2: case 0xE3: case 0xE4: return 'a'; // á, à, â, ã, ä
+    case 0xE9: case 0xE8: case 0xEA: case 0xEB: return 'e';             // é, è, ê, ë
+    case 0xED: case 0xEC: case 0xEE: case 0xEF: return 'i';            // í, ì, î, ï
+    case 0xF3: case 0xF2: case 0xF4: case 0xF5: case 0xF6: return 'o';  // ó, ò, ô, õ, ö
+    case 0xFA: case 0xF9: case 0xFB: case 0xFC: return 'u';             // ú, ù, û, ü
+    // Uppercase vowels with accents
+    case 0xC1: case 0xC0: case 0xC2: case 0xC3: case 0xC4: return 'A';  // Á, À, Â, Ã, Ä
+    case 0xC9: case 0xC8: case 0xCA: case 0xCB: return 'E';             // É, È, Ê, Ë
+    case 0xCD: case 0xCC: case 0xCE: case 0xCF: return 'I';             // Í, Ì, Î, Ï
+    case 0xD3: case 0xD2: case 0xD4: case 0xD5: case 0xD6: return 'O';  // Ó, Ò, Ô, Õ, Ö
+    case 0xDA: case 0xD9: case 0xDB: case 0xDC: return 'U';             // Ú, Ù, Û, Ü
+    // Other special chars
+    case 0xF1: return 'n';  // ñ
+    case 0xD1: return 'N';  // Ñ
+    case 0xE7: return 'c';  // ç
+    case 0xC7: return 'C';  // Ç
+    default: return c;      // No change
+  }
+}
+
+//
+// Parse given number of digits, return -1 if not all of them are digits
+//
+static int eibiParseNumber(const char *p, int digits)
+{
+  int result = 0;
+
+  for( ; digits > 0 ; --digits, ++p)
+    if(*p >= '0' && *p <= '9') result = result * 10 + *p - '0';
+    else return(-1);
+
+  return(result);
+}
+
+//
+// Parse a schedule line of given length. The line is a fixed-column
+// record: frequency in columns 0-13, time in columns 14-22, station
+// name in columns 34-57. The line is modified in place.
+//
+static bool eibiParseLine(char *line, int len, StationSchedule &entry)
+{
+  uint32_t freq;
+  char *p, *t;
+  size_t j;
+
+  // Must at least have frequency and time
+  if(len < 24) return(false);
+
+  // Parse frequency, ignoring the fractional part
+  for(j = 0, freq = 0 ; j < 14 && line[j] >= '0' && line[j] <= '9' ; ++j)
+    freq = freq < 0x10000? freq * 10 + line[j] - '0' : freq;
+  if(!freq || freq > 0xFFFF) return(false);
+  entry.freq = freq;
+
+  // Parse time
+  if(line[18] != '-') return(false);
+  int sh = eibiParseNumber(line + 14, 2);
+  int sm = eibiParseNumber(line + 16, 2);
+  int eh = eibiParseNumber(line + 19, 2);
+  int em = eibiParseNumber(line + 21, 2);
+  if(sh < 0 || sm < 0 || eh < 0 || em < 0) return(false);
+  entry.start_h = sh;
+  entry.start_m = sm;
+  entry.end_h   = eh;
+  entry.end_m   = em;
+
+  // Name is up to 24 characters, starting at column 34
+  if(len > 34 + 24) line[34 + 24] = '\0';
+  p = len > 34? line + 34 : line + len;
+
+  // Remove jammers
+  if(strstr(p, "Jammer")) return(false);
+
+  // Remove leading and trailing white space from name
+  for( ; *p==' ' || *p=='\t' ; ++p);
+  for(t = p + strlen(p) - 1 ; t>=p && (*t==' ' || *t=='\t') ; *t--='\0');
+
+  // Copy name, replacing accented characters
+  memset(entry.name, 0, sizeof(entry.name));
+  for(j = 0 ; p[j] && j < sizeof(entry.name) - 1 ; ++j)
+    entry.name[j] = replace_accented_char(p[j]);
+
+  // Done
+  return(true);
+}
+
+//
+// Parse a line received from the network and add it to the write buffer
+//
+bool eibiParseChunk(char *line, int len, StationSchedule *out)
+{
+  char *p, *t;
+
+  // Remove whitespace
+  line[len] = '\0';
+  for(p = line ; *p && *p<=' ' ; ++p);
+  for(t = line + len - 1 ; t>=p && *t<=' ' ; *t--='\0');
+
+  // Must be a valid non-empty schedule line
+  if(t<p || !isdigit(*p)) return(false);
+
+  // Remove CRs
+  for(char *s = p ; s<=t ; ++s)
+    if(*s=='\r') *s = ' ';
+
+  return(eibiParseLine(p, t - p + 1, *out));
+}
+
+//
+// Order schedule records by frequency, start time, end time, and name
+//
+int eibiCompare(const void *a, const void *b)
+{
+  const StationSchedule *x = (const StationSchedule *)a;
+  const StationSchedule *y = (const StationSchedule *)b;
+
+  if(x->freq != y->freq) return(x->freq < y->freq? -1 : 1);
+
+  int startX = x->start_h * 60 + x->start_m;
+  int startY = y->start_h * 60 + y->start_m;
+  if(startX != startY) return(startX - startY);
+
+  int endX = x->end_h * 60 + x->end_m;
+  int endY = y->end_h * 60 + y->end_m;
+  if(endX != endY) return(endX - endY);
+
+  return(strncmp(x->name, y->name, sizeof(x->name)));
+}
+
+//
+// Update FNV-1a hash with given data
+//
+uint32_t eibiHashBytes(uint32_t hash, const uint8_t *data, size_t len)
+{
+  while(len--) hash = (hash ^ *data++) * 16777619u;
+  return(hash);
+}
+
+//
+// Start an empty name table, returns FALSE if out of memory
+//
+bool eibiNamesInit(EibiNames *table)
+{
+  memset(table, 0, sizeof(*table));
+  table->hash = (uint16_t *)malloc(EIBI_HASH_SIZE * sizeof(uint16_t));
+  if(!table->hash) return(false);
+  memset(table->hash, 0xFF, EIBI_HASH_SIZE * sizeof(uint16_t));
+  return(true);
+}
+
+//
+// Free name table memory, keeping the counts
+//
+void eibiNamesFree(EibiNames *table)
+{
+  free(table->hash);
+  free(table->names);
+  table->hash  = 0;
+  table->names = 0;
+}
+
+//
+// Add name to the name table being built, reusing identical names.
+// Returns name offset in the name table.
+//
+uint16_t eibiAddName(EibiNames *table, const char *name)
+{
+  size_t len, j;
+
+  // Compute hash of the name
+  for(len = 0 ; name[len] && len < sizeof(((StationSchedule *)0)->name) - 1 ; ++len);
+  uint32_t hash = eibiHashBytes(EIBI_HASH_INIT, (const uint8_t *)name, len);
+
+  // Look for the same name in the table
+  for(j = hash % EIBI_HASH_SIZE ; table->hash[j] != 0xFFFF ; j = (j + 1) % EIBI_HASH_SIZE)
+  {
+    const char *s = table->names + table->hash[j];
+    if((uint8_t)s[0] == len && !memcmp(s + 1, name, len)) return(table->hash[j]);
+  }
+
+  // Name table is full, leave the record without a name
+  if(table->size + len + 1 >= EIBI_NO_NAME || table->count >= EIBI_HASH_SIZE / 2)
+  {
+    table->dropped++;
+    return(EIBI_NO_NAME);
+  }
+
+  // Grow name table as needed, failing the import if out of memory
+  if(table->size + len + 1 > table->alloc)
+  {
+    char *names = (char *)realloc(table->names, table->alloc + 4096);
+    if(!names)
+    {
+      table->failed = true;
+      return(EIBI_NO_NAME);
+    }
+    table->names = names;
+    table->alloc += 4096;
+  }
+
+  // Add new name
+  table->hash[j] = table->size;
+  table->names[table->size] = len;
+  memcpy(table->names + table->size + 1, name, len);
+  table->size += len + 1;
+  table->count++;
+  return(table->hash[j]);
+}
+
+//
+// Pack parsed schedule entry into a file record, adding its name to
+// the name table
+//
+void eibiPack(const StationSchedule *entry, EibiRecord *rec, EibiNames *names)
+{
+  rec->freq  = entry->freq;
+  rec->start = entry->start_h < 0? EIBI_ANY : entry->start_h * 60 + entry->start_m;
+  rec->end   = entry->end_h < 0? EIBI_ANY : entry->end_h * 60 + entry->end_m;
+  rec->name  = eibiAddName(names, entry->name);
+}
+
+//
+// Unpack file record into ENTRY. NAME holds SIZE bytes of the name
+// table starting at the record's name offset (SIZE = 0 if no name).
+//
+void eibiUnpack(const EibiRecord *rec, const uint8_t *name, size_t size, StationSchedule *entry)
+{
+  entry->freq    = rec->freq;
+  entry->start_h = rec->start == EIBI_ANY? -1 : rec->start / 60;
+  entry->start_m = rec->start == EIBI_ANY? -1 : rec->start % 60;
+  entry->end_h   = rec->end == EIBI_ANY? -1 : rec->end / 60;
+  entry->end_m   = rec->end == EIBI_ANY? -1 : rec->end % 60;
+
+  // Name length byte is followed by characters
+  size = size < sizeof(entry->name)? size : sizeof(entry->name);
+  size = !size? 0 : name[0] < size? name[0] : size - 1;
+  if(size) memcpy(entry->name, name + 1, size);
+  entry->name[size] = '\0';
+}
+
+//
+// Check schedule file header against the current format and given file
+// size, return FALSE if the file has to be imported again
+//
+bool eibiCheckHeader(const EibiHeader *header, size_t fileSize)
+{
+  return(
+    header->magic == EIBI_MAGIC && header->version == EIBI_VERSION &&
+    header->headerSize == sizeof(EibiHeader) &&
+    header->recordSize == sizeof(EibiRecord) &&
+    header->names == EIBI_RECORD_POS(header->count) &&
+    header->names + header->namesSize <= fileSize
+  );
+}
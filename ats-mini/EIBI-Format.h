@@ -0,0 +1,61 @@
+#ifndef EIBI_FORMAT_H
+#define EIBI_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "EIBI.h"
+#include "EIBI-Index.h"
+
+// Initial hash value
+#define EIBI_HASH_INIT    2166136261u
+
+// Name table slots used to find duplicate names when importing
+#define EIBI_HASH_SIZE  8192
+
+// Schedule file format, change EIBI_VERSION when changing the format
+#define EIBI_MAGIC   0x49424945 // "EIBI"
+#define EIBI_VERSION 2
+
+// Name offset meaning "no name", past the end of any name table
+#define EIBI_NO_NAME 0xFFFF
+
+// Schedule file header, followed by records and the name table
+struct EibiHeader
+{
+  uint32_t magic;       // EIBI_MAGIC
+  uint16_t version;     // EIBI_VERSION
+  uint16_t count;       // Number of records
+  uint16_t headerSize;  // sizeof(EibiHeader)
+  uint16_t recordSize;  // sizeof(EibiRecord)
+  uint32_t names;       // Name table offset in the file
+  uint32_t namesSize;   // Name table size in bytes
+};
+
+// Position of a record in the schedule file
+#define EIBI_RECORD_POS(rec) (sizeof(EibiHeader) + (rec) * sizeof(EibiRecord))
+
+// Name table built when importing the schedule
+struct EibiNames
+{
+  char *names;          // Length byte followed by characters, per name
+  uint16_t *hash;       // Name offsets, 0xFFFF = empty slot
+  size_t size;          // Bytes used
+  size_t alloc;         // Bytes allocated
+  size_t count;         // Number of names
+  size_t dropped;       // Names not fitting into the table
+  bool failed;          // Out of memory for the table
+};
+
+char replace_accented_char(char c);
+bool eibiParseChunk(char *line, int len, StationSchedule *out);
+int eibiCompare(const void *a, const void *b);
+uint32_t eibiHashBytes(uint32_t hash, const uint8_t *data, size_t len);
+bool eibiNamesInit(EibiNames *table);
+void eibiNamesFree(EibiNames *table);
+uint16_t eibiAddName(EibiNames *table, const char *name);
+void eibiPack(const StationSchedule *entry, EibiRecord *rec, EibiNames *names);
+void eibiUnpack(const EibiRecord *rec, const uint8_t *name, size_t size, StationSchedule *entry);
+bool eibiCheckHeader(const EibiHeader *header, size_t fileSize);
+
+#endif // EIBI_FORMAT_H
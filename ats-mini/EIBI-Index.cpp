@@ -0,0 +1,529 @@
+#include "EIBI-Index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Schedule records read at once
+#define EIBI_READ_SIZE 16
+
+// In-memory index of the schedule file. There is one entry per unique
+// frequency, sorted by frequency, pointing to the first record for that
+// frequency. Records for eibiFreqs[i] are eibiFirst[i]..eibiFirst[i+1]-1.
+static uint16_t *eibiFreqs  = 0;     // Unique frequencies, in ascending order
+static uint16_t *eibiFirst  = 0;     // First record per frequency, plus total
+static uint16_t eibiCount   = 0;     // Number of unique frequencies
+
+// Table of frequencies on the air now, one entry per frequency, sorted
+// by frequency. It is only updated when the clock crosses a minute at
+// which some schedule starts or ends (marked in eibiBounds[]).
+static uint16_t *eibiNowIdx = 0;     // Index of an on-air frequency
+static uint16_t *eibiNowRec = 0;     // First on-air record at that frequency
+static uint16_t eibiNowCount = 0;    // Number of on-air frequencies
+static int eibiNowMinute = -1;       // Minute of the day the table is valid for
+static uint8_t eibiBounds[EIBI_DAY / 8]; // Minutes when schedules start or end
+
+// Frequencies with schedules starting or ending at each minute of the
+// day. Indices for minute M are eibiBoundIdx[eibiBoundFirst[M]] up to
+// eibiBoundIdx[eibiBoundFirst[M+1]-1]. Only these frequencies change in
+// the on-air table at minute M. The table is rebuilt if these are NULL.
+static uint16_t *eibiBoundFirst = 0; // First index per minute, plus total
+static uint16_t *eibiBoundIdx   = 0; // Frequency indices
+
+// Schedule records are read with this function
+static EibiReader eibiReader = 0;
+static EibiRecord eibiBuf[EIBI_READ_SIZE];
+
+//
+// Return TRUE if given entry is on the air at given minute of the day
+//
+bool eibiIsNow(const EibiRecord *entry, int now)
+{
+  // Check if entry applies to all hours
+  if(entry->start == EIBI_ANY || entry->end == EIBI_ANY) return(true);
+
+  // These are starting/ending times in minutes
+  int start = entry->start;
+  int end   = entry->end;
+
+  // Check for inclusive schedule
+  if(start <= end && now >= start && now <= end) return(true);
+
+  // Check for exclusive schedule
+  if(start > end && (now >= start || now <= end)) return(true);
+
+  // Nope
+  return(false);
+}
+
+//
+// Get minutes at which given entry goes on and off the air, return
+// FALSE if it is on the air all the time
+//
+static bool eibiGetBounds(const EibiRecord *entry, int *start, int *end)
+{
+  // Entries that apply to all hours never change
+  if(entry->start == EIBI_ANY || entry->end == EIBI_ANY) return(false);
+
+  // Entries starting at 2400 or ending at 2359 and 2400 switch at midnight
+  *start = entry->start < EIBI_DAY? entry->start : 0;
+  *end   = entry->end + 1 < EIBI_DAY? entry->end + 1 : 0;
+  return(true);
+}
+
+//
+// Mark minutes at which given entry goes on and off the air, counting
+// frequency indices per minute in COUNT[] (if given). LAST[] keeps the
+// last frequency index counted for each minute, to count it only once.
+//
+static void eibiMarkBounds(const EibiRecord *entry, int idx, uint16_t *count, uint16_t *last)
+{
+  int bound[2];
+
+  if(!eibiGetBounds(entry, &bound[0], &bound[1])) return;
+
+  for(int j = 0 ; j < 2 ; j++)
+  {
+    int m = bound[j];
+
+    eibiBounds[m >> 3] |= 1 << (m & 7);
+
+    if(count && last[m] != idx)
+    {
+      last[m] = idx;
+      count[m + 1]++;
+    }
+  }
+}
+
+//
+// Build per-minute lists of frequency indices with schedules starting or
+// ending at that minute, using per-minute counts in eibiBoundFirst[].
+// Returns FALSE if the lists could not be built.
+//
+static bool eibiBoundBuild(uint16_t *last)
+{
+  size_t total = eibiFirst[eibiCount];
+  size_t size  = 0;
+  size_t rec;
+  int idx = 0;
+
+  // Turn counts into positions
+  for(int m = 0 ; m < EIBI_DAY ; m++)
+  {
+    size += eibiBoundFirst[m + 1];
+    if(size > 0xFFFF) return(false);
+    eibiBoundFirst[m + 1] = size;
+  }
+
+  eibiBoundIdx = (uint16_t *)malloc((size? size : 1) * sizeof(uint16_t));
+  if(!eibiBoundIdx) return(false);
+
+  // Fill lists in frequency order, advancing each minute's position
+  memset(last, 0xFF, EIBI_DAY * sizeof(uint16_t));
+  for(rec = 0 ; rec < total ; )
+  {
+    size_t n = total - rec < EIBI_READ_SIZE? total - rec : EIBI_READ_SIZE;
+
+    // Read a chunk of records
+    if(!eibiReader(rec, eibiBuf, n)) return(false);
+
+    for(size_t j = 0 ; j < n ; j++, rec++)
+    {
+      int bound[2];
+
+      // Find frequency this record belongs to
+      while(eibiFirst[idx + 1] <= rec) idx++;
+
+      if(!eibiGetBounds(&eibiBuf[j], &bound[0], &bound[1])) continue;
+
+      for(int k = 0 ; k < 2 ; k++)
+        if(last[bound[k]] != idx)
+        {
+          last[bound[k]] = idx;
+          eibiBoundIdx[eibiBoundFirst[bound[k]]++] = idx;
+        }
+    }
+  }
+
+  // Positions now point to the next minute's lists, shift them back
+  memmove(eibiBoundFirst + 1, eibiBoundFirst, EIBI_DAY * sizeof(uint16_t));
+  eibiBoundFirst[0] = 0;
+  return(true);
+}
+
+void eibiIndexFree()
+{
+  free(eibiFreqs);
+  free(eibiFirst);
+  free(eibiNowIdx);
+  free(eibiNowRec);
+  free(eibiBoundFirst);
+  free(eibiBoundIdx);
+  eibiFreqs      = 0;
+  eibiFirst      = 0;
+  eibiNowIdx     = 0;
+  eibiNowRec     = 0;
+  eibiBoundFirst = 0;
+  eibiBoundIdx   = 0;
+  eibiCount      = 0;
+  eibiNowCount   = 0;
+  eibiNowMinute  = -1;
+  eibiReader     = 0;
+}
+
+//
+// Build the frequency index from TOTAL records sorted by frequency,
+// read with READER. Returns FALSE if there is nothing to index.
+//
+bool eibiIndexBuild(size_t total, EibiReader reader)
+{
+  size_t allocated = 0;
+  size_t rec;
+  bool oom = false;
+
+  // Drop existing index
+  eibiIndexFree();
+  memset(eibiBounds, 0, sizeof(eibiBounds));
+  eibiReader = reader;
+
+  // Count frequencies changing at each minute, if there is memory for it
+  uint16_t *last = (uint16_t *)malloc(EIBI_DAY * sizeof(uint16_t));
+  eibiBoundFirst = (uint16_t *)calloc(EIBI_DAY + 1, sizeof(uint16_t));
+  if(last) memset(last, 0xFF, EIBI_DAY * sizeof(uint16_t));
+
+  for(rec = 0 ; rec < total && !oom ; )
+  {
+    size_t n = total - rec < EIBI_READ_SIZE? total - rec : EIBI_READ_SIZE;
+
+    // Read a chunk of records
+    if(!reader(rec, eibiBuf, n)) break;
+
+    for(size_t j = 0 ; j < n && !oom ; j++, rec++)
+    {
+      // Same frequency as the last index entry, skip
+      if(eibiCount && eibiBuf[j].freq == eibiFreqs[eibiCount - 1])
+      {
+        // Remember when this entry goes on and off the air
+        eibiMarkBounds(&eibiBuf[j], eibiCount - 1, last && eibiBoundFirst? eibiBoundFirst : 0, last);
+        continue;
+      }
+
+      // Grow index as needed, keeping one extra slot for the total
+      if(eibiCount + 1u >= allocated)
+      {
+        uint16_t *freqs = (uint16_t *)realloc(eibiFreqs, (allocated + 256) * sizeof(uint16_t));
+        if(freqs) eibiFreqs = freqs;
+        uint16_t *first = (uint16_t *)realloc(eibiFirst, (allocated + 256) * sizeof(uint16_t));
+        if(first) eibiFirst = first;
+
+        // Out of memory
+        if(!freqs || !first) { oom = true; break; }
+
+        allocated += 256;
+      }
+
+      eibiFreqs[eibiCount] = eibiBuf[j].freq;
+      eibiFirst[eibiCount] = rec;
+      eibiMarkBounds(&eibiBuf[j], eibiCount, last && eibiBoundFirst? eibiBoundFirst : 0, last);
+      eibiCount++;
+    }
+  }
+
+  // Allocate table of frequencies on the air now
+  if(eibiCount)
+  {
+    eibiNowIdx = (uint16_t *)malloc(eibiCount * sizeof(uint16_t));
+    eibiNowRec = (uint16_t *)malloc(eibiCount * sizeof(uint16_t));
+  }
+
+  // Drop everything if the records could not be indexed completely
+  if(rec < total || !eibiCount || !eibiNowIdx || !eibiNowRec)
+  {
+    free(last);
+    eibiIndexFree();
+    return(false);
+  }
+
+  // Terminate the index with the total number of records
+  eibiFirst[eibiCount] = rec;
+
+  // Without per-minute lists, the on-air table is rebuilt as a whole
+  if(!last || !eibiBoundFirst || !eibiBoundBuild(last))
+  {
+    free(eibiBoundFirst);
+    free(eibiBoundIdx);
+    eibiBoundFirst = 0;
+    eibiBoundIdx   = 0;
+  }
+
+  free(last);
+  return(true);
+}
+
+//
+// Return number of indexed frequencies
+//
+int eibiIndexCount()
+{
+  return(eibiCount);
+}
+
+//
+// Return frequency at given index position
+//
+uint16_t eibiIndexFreq(int idx)
+{
+  return(eibiFreqs[idx]);
+}
+
+//
+// Return first record for frequency at given index position, or the
+// total number of records for the position past the last frequency
+//
+size_t eibiIndexFirst(int idx)
+{
+  return(eibiFirst[idx]);
+}
+
+//
+// Return index of the frequency containing given record
+//
+int eibiIndexFind(size_t rec)
+{
+  int l, r;
+
+  for(l = 0, r = eibiCount - 1 ; l < r ; )
+  {
+    int m = (l + r + 1) >> 1;
+    if(eibiFirst[m] <= rec) l = m; else r = m - 1;
+  }
+
+  return(l);
+}
+
+//
+// Starting with record REC, find the first record at frequency index
+// IDX that is on the air NOW. Records for the same frequency are read
+// together. Returns record number and copies the record to FOUND, or
+// returns -1 if not found.
+//
+int eibiIndexFindNow(int idx, size_t rec, int now, EibiRecord *found)
+{
+  size_t last = eibiFirst[idx + 1];
+
+  if(rec < eibiFirst[idx]) rec = eibiFirst[idx];
+
+  while(rec < last)
+  {
+    size_t n = last - rec < EIBI_READ_SIZE? last - rec : EIBI_READ_SIZE;
+
+    // Read records for this frequency
+    if(!eibiReader(rec, eibiBuf, n)) return(-1);
+
+    for(size_t j = 0 ; j < n ; j++, rec++)
+      if(eibiIsNow(&eibiBuf[j], now))
+      {
+        if(found) *found = eibiBuf[j];
+        return(rec);
+      }
+  }
+
+  // Not found
+  return(-1);
+}
+
+//
+// Rebuild the table of frequencies on the air at given minute of the day
+//
+static void eibiNowBuild(int now)
+{
+  size_t total = eibiFirst[eibiCount];
+  size_t rec;
+  int idx = 0;
+
+  eibiNowCount  = 0;
+  eibiNowMinute = -1;
+
+  for(rec = 0 ; rec < total ; )
+  {
+    size_t n = total - rec < EIBI_READ_SIZE? total - rec : EIBI_READ_SIZE;
+
+    // Read a chunk of records
+    if(!eibiReader(rec, eibiBuf, n)) return;
+
+    for(size_t j = 0 ; j < n ; j++, rec++)
+    {
+      // Find frequency this record belongs to
+      while(eibiFirst[idx + 1] <= rec) idx++;
+
+      // Add the first on-air record for each frequency
+      if(eibiIsNow(&eibiBuf[j], now) && (!eibiNowCount || eibiNowIdx[eibiNowCount - 1] != idx))
+      {
+        eibiNowIdx[eibiNowCount] = idx;
+        eibiNowRec[eibiNowCount] = rec;
+        eibiNowCount++;
+      }
+    }
+  }
+
+  eibiNowMinute = now;
+}
+
+//
+// Update on-air table entry for frequency index IDX at given minute,
+// adding, replacing, or removing it. Returns FALSE on read failure.
+//
+static bool eibiNowChange(int idx, int now)
+{
+  int l, r;
+
+  // Find position of this frequency in the table
+  for(l = 0, r = eibiNowCount ; l < r ; )
+  {
+    int m = (l + r) >> 1;
+    if(eibiNowIdx[m] < idx) l = m + 1; else r = m;
+  }
+
+  bool present = l < eibiNowCount && eibiNowIdx[l] == idx;
+  size_t last  = eibiFirst[idx + 1];
+  size_t rec;
+
+  // Find the first record on the air now at this frequency
+  for(rec = eibiFirst[idx] ; rec < last ; )
+  {
+    size_t n = last - rec < EIBI_READ_SIZE? last - rec : EIBI_READ_SIZE;
+    size_t j;
+
+    if(!eibiReader(rec, eibiBuf, n)) return(false);
+    for(j = 0 ; j < n && !eibiIsNow(&eibiBuf[j], now) ; j++, rec++);
+    if(j < n) break;
+  }
+
+  if(rec < last && present)
+  {
+    // Still on the air, possibly with a different record
+    eibiNowRec[l] = rec;
+  }
+  else if(rec < last)
+  {
+    // Went on the air
+    memmove(eibiNowIdx + l + 1, eibiNowIdx + l, (eibiNowCount - l) * sizeof(uint16_t));
+    memmove(eibiNowRec + l + 1, eibiNowRec + l, (eibiNowCount - l) * sizeof(uint16_t));
+    eibiNowIdx[l] = idx;
+    eibiNowRec[l] = rec;
+    eibiNowCount++;
+  }
+  else if(present)
+  {
+    // Went off the air
+    eibiNowCount--;
+    memmove(eibiNowIdx + l, eibiNowIdx + l + 1, (eibiNowCount - l) * sizeof(uint16_t));
+    memmove(eibiNowRec + l, eibiNowRec + l + 1, (eibiNowCount - l) * sizeof(uint16_t));
+  }
+
+  return(true);
+}
+
+//
+// Make sure the table of on-air frequencies is valid for given minute,
+// updating only frequencies with schedules starting or ending since the
+// last time
+//
+void eibiNowUpdate(int now)
+{
+  if(!eibiCount || now == eibiNowMinute) return;
+
+  // No valid table yet, build it
+  if(eibiNowMinute < 0)
+  {
+    eibiNowBuild(now);
+    return;
+  }
+
+  // Clock moved backwards (i.e. corrected by NTP or RDS), rebuild
+  int ahead = (now - eibiNowMinute + EIBI_DAY) % EIBI_DAY;
+  if(ahead > EIBI_DAY / 2)
+  {
+    eibiNowBuild(now);
+    return;
+  }
+
+  int m, changes = 0;
+
+  // Count schedule changes since the last update
+  for(m = eibiNowMinute ; m != now ; )
+  {
+    m = (m + 1) % EIBI_DAY;
+    if(eibiBounds[m >> 3] & (1 << (m & 7)))
+      changes += eibiBoundFirst? eibiBoundFirst[m + 1] - eibiBoundFirst[m] : eibiCount;
+  }
+
+  // Nothing has changed, the table is still valid
+  if(!changes)
+  {
+    eibiNowMinute = now;
+    return;
+  }
+
+  // Rebuilding takes fewer reads than updating one by one
+  if(!eibiBoundFirst || changes > (int)(eibiFirst[eibiCount] / EIBI_READ_SIZE))
+  {
+    eibiNowBuild(now);
+    return;
+  }
+
+  // Update only frequencies with schedules starting or ending
+  for(m = eibiNowMinute ; m != now ; )
+  {
+    m = (m + 1) % EIBI_DAY;
+    for(int j = eibiBoundFirst[m] ; j < eibiBoundFirst[m + 1] ; j++)
+      if(!eibiNowChange(eibiBoundIdx[j], now))
+      {
+        // Failed to read the schedule, try again later
+        eibiNowMinute = -1;
+        return;
+      }
+  }
+
+  eibiNowMinute = now;
+}
+
+//
+// Return number of frequencies on the air now
+//
+int eibiNowSize()
+{
+  return(eibiNowCount);
+}
+
+//
+// Return position of the first on-air frequency greater or equal to freq
+//
+int eibiNowFind(uint16_t freq)
+{
+  int l, r;
+
+  for(l = 0, r = eibiNowCount ; l < r ; )
+  {
+    int m = (l + r) >> 1;
+    if(eibiFreqs[eibiNowIdx[m]] < freq) l = m + 1; else r = m;
+  }
+
+  return(l);
+}
+
+//
+// Return on-air frequency at given position
+//
+uint16_t eibiNowFreq(int pos)
+{
+  return(eibiFreqs[eibiNowIdx[pos]]);
+}
+
+//
+// Return the first on-air record for frequency at given position
+//
+size_t eibiNowRecord(int pos)
+{
+  return(eibiNowRec[pos]);
+}
@@ -0,0 +1,40 @@
+#ifndef EIBI_INDEX_H
+#define EIBI_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Minutes in a day
+#define EIBI_DAY (24 * 60)
+
+// Starting or ending time meaning "any time"
+#define EIBI_ANY 0xFFFF
+
+// Schedule record, as stored in the file. Names are stored in the name
+// table as a length byte followed by characters.
+struct EibiRecord
+{
+  uint16_t freq;        // Frequency in kHz
+  uint16_t start;       // Starting minute of the day (EIBI_ANY = any)
+  uint16_t end;         // Ending minute of the day (EIBI_ANY = any)
+  uint16_t name;        // Name offset in the name table
+};
+
+// Read N records starting with REC into BUF, return FALSE on failure
+typedef bool (*EibiReader)(size_t rec, EibiRecord *buf, size_t n);
+
+bool eibiIsNow(const EibiRecord *entry, int now);
+bool eibiIndexBuild(size_t total, EibiReader reader);
+void eibiIndexFree();
+int eibiIndexCount();
+uint16_t eibiIndexFreq(int idx);
+size_t eibiIndexFirst(int idx);
+int eibiIndexFind(size_t rec);
+int eibiIndexFindNow(int idx, size_t rec, int now, EibiRecord *found);
+void eibiNowUpdate(int now);
+int eibiNowSize();
+int eibiNowFind(uint16_t freq);
+uint16_t eibiNowFreq(int pos);
+size_t eibiNowRecord(int pos);
+
+#endif // EIBI_INDEX_H
@@ -1,17 +1,19 @@
 #include "Common.h"
-#include "Draw.h"
 #include "EIBI.h"
+#include "EIBI-Format.h"
 
 #include <HTTPClient.h>
 #include <WiFi.h>
 #include <LittleFS.h>
 #include <FS.h>
 
-#include <ctype.h>
 #include <string.h>
 
 #define EIBI_PATH "/schedules.bin"
 #define TEMP_PATH "/schedules.tmp"
+#define RUNS_PATH "/schedules.run"
+#define META_PATH "/schedules.meta"
+#define MTMP_PATH "/schedules.mtmp"
 #ifndef EIBI_URL
 #define EIBI_URL  "http://eibispace.de/dx/eibi.txt"
 #endif
@@ -63,418 +65,761 @@ const BandLabel bandLabels[] =
   {29600, 30000,  "9m BC"         }
 };
 
-// FIXME: this might be slow
-bool eibiAvailable()
-{
-  return(LittleFS.exists(EIBI_PATH));
-}
+// Network data read at once, must fit the longest schedule line
+#define EIBI_NET_SIZE   4096
 
-static bool entryIsNow(const StationSchedule *entry, int now)
-{
-  // Check if entry applies to all hours
-  if(entry->start_h < 0 || entry->end_h < 0) return(true);
+// Schedule records written to flash at once
+#define EIBI_WRITE_SIZE 64
 
-  // These are starting/ending times in minutes
-  int start = entry->start_h * 60 + entry->start_m;
-  int end   = entry->end_h * 60 + entry->end_m;
+// Schedule records sorted in RAM at once when importing
+#define EIBI_RUN_SIZE   512
 
-  // Check for inclusive schedule
-  if(start <= end && now >= start && now <= end) return(true);
+// Schedule records read at once from each sorted run when merging runs
+#define EIBI_MERGE_SIZE 16
 
-  // Check for exclusive schedule
-  if(start > end && (now >= start || now <= end)) return(true);
+// Loader task stack size in bytes
+#define EIBI_TASK_STACK   8192
 
-  // Nope
-  return(false);
+// Time to show final loading message (ms)
+#define EIBI_MESSAGE_TIME 3000
+
+// Schedule file stays open while the index is valid
+static fs::File eibiFile;
+static EibiHeader eibiHeader;
+static bool eibiIndexed = false; // TRUE: index has been built
+static bool eibiReimport = false; // TRUE: saved schedule has to be loaded again
+
+// Last found entry, returned by the lookup functions
+static StationSchedule eibiEntry;
+
+// Schedule loading states
+#define EIBI_IDLE    0 // Not loading
+#define EIBI_LOADING 1 // Loader task is running
+#define EIBI_DONE    2 // Loader task has finished, new schedule is ready
+#define EIBI_FAILED  3 // Loader task has failed
+#define EIBI_SHOWING 4 // Showing final message
+#define EIBI_SAME    5 // Loader task has found schedule unchanged
+
+// Loading status, written by the loader task, polled by the main loop.
+// The main loop only changes state after the loader task is done.
+static volatile struct
+{
+  uint8_t state;        // EIBI_IDLE, EIBI_LOADING, ...
+  const char *message;  // Status message, or 0 to show counts
+  uint32_t bytes;       // Bytes downloaded
+  uint32_t entries;     // Schedule entries parsed
+} eibiStatus = { EIBI_IDLE, 0, 0, 0 };
+
+// Download validators, saved next to the schedule
+struct EibiMeta
+{
+  uint32_t version;     // EIBI_VERSION of the saved schedule
+  uint32_t hash;        // Hash of the downloaded text
+  char etag[80];        // ETag header
+  char modified[40];    // Last-Modified header
+};
+
+// Name table built when importing the schedule
+static EibiNames importNames;
+
+//
+// Drop the frequency index and close the schedule file
+//
+static void eibiClose()
+{
+  if(eibiFile) eibiFile.close();
+  eibiIndexFree();
+  eibiIndexed = false;
 }
 
-const StationSchedule *eibiNext(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+//
+// Read N records starting with REC from the schedule file
+//
+static bool eibiReadRecords(size_t rec, EibiRecord *buf, size_t n)
 {
-  // Will return this static entry
-  static StationSchedule entry;
+  size_t pos = EIBI_RECORD_POS(rec);
 
-  // Must have valid offset
-  if(!offset) return(NULL);
+  // Records are mostly read in sequence, only seek when needed
+  if(eibiFile.position() != pos && !eibiFile.seek(pos, fs::SeekSet)) return(false);
+  return(eibiFile.read((uint8_t *)buf, n * sizeof(EibiRecord)) == n * sizeof(EibiRecord));
+}
 
-  // If no valid offset yet, find some
-  if(*offset==(size_t)-1) eibiLookup(freq, hour, minute, offset);
+//
+// Open the schedule file and build the frequency index. This is done
+// once, when the schedule is first used or replaced.
+//
+static bool eibiOpen()
+{
+  // Drop existing index
+  eibiClose();
+  eibiIndexed = true;
 
   // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
-
-  StationSchedule *result = NULL;
-  int now = hour * 60 + minute;
+  eibiFile = LittleFS.open(EIBI_PATH, "rb");
+  if(!eibiFile) return(false);
+
+  // Check file format. Schedules saved by other versions are dropped
+  // and loaded again once connected to the network.
+  if(
+    eibiFile.read((uint8_t *)&eibiHeader, sizeof(eibiHeader)) != sizeof(eibiHeader) ||
+    !eibiCheckHeader(&eibiHeader, eibiFile.size())
+  )
+  {
+    eibiFile.close();
+    LittleFS.remove(EIBI_PATH);
+    LittleFS.remove(META_PATH);
+    eibiReimport = true;
+    return(false);
+  }
 
-  // Go to the starting offset
-  if(!file.seek(*offset, fs::SeekSet))
+  // Index records
+  if(!eibiIndexBuild(eibiHeader.count, eibiReadRecords))
   {
-    file.close();
-    return(NULL);
+    eibiFile.close();
+    return(false);
   }
 
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
+  return(true);
+}
+
+//
+// Build the index if it has not been built yet, return TRUE if there
+// are schedule records to look up
+//
+static bool eibiIndexInit()
+{
+  return(eibiIndexed? eibiIndexCount() > 0 : eibiOpen());
+}
+
+//
+// Unpack given record into eibiEntry, reading its name from the name table
+//
+static bool eibiLoadEntry(const EibiRecord *rec)
+{
+  uint8_t buf[sizeof(eibiEntry.name)];
+  size_t size = 0;
+
+  // Read name length and characters at once
+  if(rec->name < eibiHeader.namesSize)
   {
-    if((entry.freq>freq) && entryIsNow(&entry, now))
-    {
-      *offset = file.position() - sizeof(entry);
-      result = &entry;
-      break;
-    }
+    size = eibiHeader.namesSize - rec->name;
+    size = size < sizeof(buf)? size : sizeof(buf);
+    if(!eibiFile.seek(eibiHeader.names + rec->name, fs::SeekSet)) return(false);
+    if(eibiFile.read(buf, size) != size) return(false);
   }
 
-  file.close();
-  return(result);
+  eibiUnpack(rec, buf, size, &eibiEntry);
+  return(true);
 }
 
-const StationSchedule *eibiPrev(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+//
+// Read a single record into eibiEntry
+//
+static bool eibiRead(size_t rec)
 {
-  // Will return this static entry
-  static StationSchedule entry;
+  EibiRecord entry;
 
-  // Must have valid offset
-  if(!offset) return(NULL);
+  return(
+    eibiFile.seek(EIBI_RECORD_POS(rec), fs::SeekSet) &&
+    eibiFile.read((uint8_t *)&entry, sizeof(entry)) == sizeof(entry) &&
+    eibiLoadEntry(&entry)
+  );
+}
 
-  // If no valid offset yet, find some
-  if(*offset==(size_t)-1) eibiLookup(freq, hour, minute, offset);
+bool eibiAvailable()
+{
+  return(eibiIndexInit());
+}
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+void eibiSetTime(uint8_t hour, uint8_t minute)
+{
+  if(eibiIndexInit()) eibiNowUpdate(hour * 60 + minute);
+}
 
-  StationSchedule *result = NULL;
-  int now = hour * 60 + minute;
+uint16_t eibiNextFreq(uint16_t freq, uint8_t hour, uint8_t minute)
+{
+  if(!eibiIndexInit()) return(0);
+  eibiNowUpdate(hour * 60 + minute);
 
-  for(size_t pos = *offset; file.seek(pos, fs::SeekSet) ; pos -= sizeof(entry))
-  {
-    if(file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+  // First on-air frequency above the given one
+  int pos = eibiNowFind(freq + 1);
+  return(pos < eibiNowSize()? eibiNowFreq(pos) : 0);
+}
 
-    if((entry.freq<freq) && entryIsNow(&entry, now))
-    {
-      *offset = pos;
-      result = &entry;
-      break;
-    }
-  }
+uint16_t eibiPrevFreq(uint16_t freq, uint8_t hour, uint8_t minute)
+{
+  if(!eibiIndexInit()) return(0);
+  eibiNowUpdate(hour * 60 + minute);
 
-  file.close();
-  return(result);
+  // Last on-air frequency below the given one
+  int pos = eibiNowFind(freq) - 1;
+  return(pos >= 0? eibiNowFreq(pos) : 0);
 }
 
 const StationSchedule *eibiAtSameFreq(uint8_t hour, uint8_t minute, size_t *offset, bool same)
 {
-  // Will return this static entry
-  static StationSchedule entry;
-
   // Must have valid offset
-  if(!offset) return(NULL);
-
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+  if(!offset || !eibiIndexInit()) return(NULL);
+  if(*offset < EIBI_RECORD_POS(0)) return(NULL);
 
-  // Read current entry to get frequency
-  StationSchedule e0;
-  if(!file.seek(*offset, fs::SeekSet) || file.read((uint8_t*)&e0, sizeof(e0)) != sizeof(e0))
-  {
-    file.close();
-    return(NULL);
-  }
+  size_t rec = (*offset - EIBI_RECORD_POS(0)) / sizeof(EibiRecord);
+  if(rec >= eibiIndexFirst(eibiIndexCount())) return(NULL);
 
-  StationSchedule *result = NULL;
+  // Start with the current entry if it can be returned again,
+  // otherwise start with the next one
+  EibiRecord entry;
+  int idx = eibiIndexFind(rec);
   int now = hour * 60 + minute;
+  int found = eibiIndexFindNow(idx, same? rec : rec + 1, now, &entry);
 
-  if(same && entryIsNow(&e0, now))
-  {
-    entry = e0;
-    result = &entry;
-    file.close();
-    return(result);
-  }
-
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
-  {
-    if(entry.freq != e0.freq)
-      break;
-    else if(entryIsNow(&entry, now))
-    {
-      *offset = file.position() - sizeof(entry);
-      result = &entry;
-      break;
-    }
-  }
+  // Drop out if not found
+  if(found < 0 || !eibiLoadEntry(&entry)) return(NULL);
 
-  file.close();
-  return(result);
+  *offset = EIBI_RECORD_POS(found);
+  return(&eibiEntry);
 }
 
 const StationSchedule *eibiLookup(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
 {
-  // Will return this static entry
-  static StationSchedule entry;
+  // Must have schedule data
+  if(!eibiIndexInit()) return(NULL);
+  eibiNowUpdate(hour * 60 + minute);
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
-
-  // Set up binary search
-  ssize_t total = file.size() / sizeof(entry);
-  ssize_t left  = 0;
-  ssize_t right = total;
-  ssize_t match = -1;
-  ssize_t mid;
-
-  // Search for the frequency
-  while(left <= right)
-  {
-    // Go to the middle entry
-    mid = (left + right) / 2;
+  // Find frequency among the ones on the air now
+  int pos = eibiNowFind(freq);
+  if(pos >= eibiNowSize() || eibiNowFreq(pos) != freq) return(NULL);
 
-    // Save current offset, correcting for file size
-    if(offset) *offset = (mid<0? 0 : mid>=total? total-1 : mid) * sizeof(entry);
+  // Read the first on-air entry
+  if(!eibiRead(eibiNowRecord(pos))) return(NULL);
 
-    // Go to the middle entry
-    if(!file.seek(mid * sizeof(entry), fs::SeekSet))
-    {
-      file.close();
-      return(NULL);
-    }
+  // Report offset of the found entry within the file
+  if(offset) *offset = EIBI_RECORD_POS(eibiNowRecord(pos));
+  return(&eibiEntry);
+}
 
-    // Read middle entry
-    if(file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry))
+//
+// Sort records from given file in runs of EIBI_RUN_SIZE records and
+// write sorted runs to the runs file. Returns number of runs or -1.
+//
+static int eibiSortRuns(const char *path, StationSchedule *buf, size_t *total)
+{
+  fs::File src = LittleFS.open(path, "rb");
+  fs::File dst = LittleFS.open(RUNS_PATH, "wb");
+  size_t size;
+  int runCnt;
+
+  *total = 0;
+  if(!src || !dst) runCnt = -1;
+  else
+  {
+    size = src.size() / sizeof(StationSchedule);
+
+    for(runCnt = 0 ; *total < size ; runCnt++)
     {
-      file.close();
-      return(NULL);
+      size_t n = size - *total < EIBI_RUN_SIZE? size - *total : EIBI_RUN_SIZE;
+      size_t bytes = n * sizeof(StationSchedule);
+
+      // Read, sort, and write a run of records
+      if(src.read((uint8_t *)buf, bytes) != bytes) { runCnt = -1; break; }
+      qsort(buf, n, sizeof(StationSchedule), eibiCompare);
+      if(dst.write((uint8_t *)buf, bytes) != bytes) { runCnt = -1; break; }
+
+      *total += n;
     }
+  }
+
+  if(src) src.close();
+  if(dst) dst.close();
+  return(runCnt);
+}
 
-    // Compare frequency
-    if(entry.freq < freq)
-      left = mid + 1;
-    else if(entry.freq > freq)
-      right = mid - 1;
-    else
+//
+// Merge sorted runs from the runs file into given file, dropping
+// duplicate records and writing them in the compact format. The buffer
+// is split between the output and input buffers for each run. With many
+// runs, larger input buffers are allocated to read fewer times.
+// Returns an error message or 0 on success.
+//
+static const char *eibiMergeRuns(const char *path, StationSchedule *buf, size_t total, int runCnt)
+{
+  struct Run
+  {
+    StationSchedule *buf; // Records read from this run
+    size_t next;          // Next record to read from the runs file
+    size_t left;          // Records left to read from the runs file
+    int pos;              // Current record in the buffer
+    int count;            // Records in the buffer
+  };
+
+  const int outSize = EIBI_WRITE_SIZE * sizeof(StationSchedule) / sizeof(EibiRecord);
+  size_t inSize = runCnt? (EIBI_RUN_SIZE - EIBI_WRITE_SIZE) / runCnt : 1;
+  StationSchedule *inBuf = buf + EIBI_WRITE_SIZE;
+  StationSchedule *mergeBuf = 0;
+
+  // Too many runs to read them efficiently from the sort buffer, try
+  // allocating input buffers, halving them if out of memory
+  for(size_t n = EIBI_MERGE_SIZE ; runCnt && n > inSize && !mergeBuf ; n /= 2)
+    if((mergeBuf = (StationSchedule *)malloc(runCnt * n * sizeof(StationSchedule))))
     {
-      match = mid;
-      right = mid - 1;
+      inBuf  = mergeBuf;
+      inSize = n;
     }
-  }
 
-  // Drop out if not found
-  if(match < 0)
+  struct Run *runs = (struct Run *)malloc((runCnt? runCnt : 1) * sizeof(struct Run));
+  fs::File src = LittleFS.open(RUNS_PATH, "rb");
+  fs::File dst = LittleFS.open(path, "wb");
+  EibiRecord *out = (EibiRecord *)buf;
+  EibiHeader header = { EIBI_MAGIC, EIBI_VERSION, 0, sizeof(EibiHeader), sizeof(EibiRecord), 0, 0 };
+  StationSchedule last;
+  const char *error = 0;
+  int outCnt = 0;
+  bool ok = runs && src && dst && inSize > 0;
+
+  // Leave space for the header, it is written when done
+  if(ok) ok = dst.write((uint8_t *)&header, sizeof(header)) == sizeof(header);
+
+  // Set up runs
+  for(int r = 0 ; ok && r < runCnt ; r++)
   {
-    file.close();
-    return(NULL);
+    runs[r].buf   = inBuf + r * inSize;
+    runs[r].next  = r * EIBI_RUN_SIZE;
+    runs[r].left  = total - runs[r].next < EIBI_RUN_SIZE? total - runs[r].next : EIBI_RUN_SIZE;
+    runs[r].pos   = 0;
+    runs[r].count = 0;
   }
 
-  // If found entry is not the same as the last read entry...
-  if(match != mid)
+  for(bool first = true ; ok ; )
   {
-    // Read the right entry
-    if(file.seek(match * sizeof(entry), fs::SeekSet))
-      if(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
-        mid = match;
+    int best = -1;
 
-    // Drop out if failed to read
-    if(match != mid)
+    // Find the smallest record among all runs
+    for(int r = 0 ; ok && r < runCnt ; r++)
     {
-      file.close();
-      return(NULL);
+      struct Run *run = &runs[r];
+
+      // Refill run buffer when empty
+      if(run->pos >= run->count && run->left)
+      {
+        size_t n = run->left < inSize? run->left : inSize;
+        size_t bytes = n * sizeof(StationSchedule);
+
+        ok = src.seek(run->next * sizeof(StationSchedule), fs::SeekSet) &&
+             src.read((uint8_t *)run->buf, bytes) == bytes;
+
+        run->next += n;
+        run->left -= n;
+        run->pos   = 0;
+        run->count = n;
+      }
+
+      if(run->pos < run->count &&
+        (best < 0 || eibiCompare(&run->buf[run->pos], &runs[best].buf[runs[best].pos]) < 0))
+        best = r;
     }
-  }
 
-  // This is our current time in minutes
-  int now = hour * 60 + minute;
+    // Done when all runs are exhausted
+    if(!ok || best < 0) break;
 
-  // Keep reading entries from file
-  do
-  {
-    // Report offset within the file
-    if(offset) *offset = file.position() - sizeof(entry);
+    // Take the record, dropping duplicates
+    const StationSchedule *entry = &runs[best].buf[runs[best].pos++];
+    if(!first && !eibiCompare(entry, &last)) continue;
+    last  = *entry;
+    first = false;
 
-    // Match frequency
-    if(entry.freq != freq) break;
+    // Fail if the index can not address this record
+    if(header.count >= 0xFFFF) { error = "Schedule too large!"; ok = false; break; }
 
-    // Match time
-    if(entryIsNow(&entry, now))
+    // Pack the record, failing if out of memory for its name
+    eibiPack(entry, &out[outCnt++], &importNames);
+    header.count++;
+    if(importNames.failed) { ok = false; break; }
+
+    // Flush output buffer when full
+    if(outCnt >= outSize)
     {
-      file.close();
-      return(&entry);
+      ok = dst.write((uint8_t *)out, outCnt * sizeof(EibiRecord)) == outCnt * sizeof(EibiRecord);
+      outCnt = 0;
     }
   }
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry));
 
-  // Not found
-  file.close();
-  return(NULL);
+  // Flush remaining records
+  if(ok && outCnt)
+    ok = dst.write((uint8_t *)out, outCnt * sizeof(EibiRecord)) == outCnt * sizeof(EibiRecord);
+
+  // Write name table and the final header
+  header.names     = EIBI_RECORD_POS(header.count);
+  header.namesSize = importNames.size;
+  if(ok && importNames.size)
+    ok = dst.write((uint8_t *)importNames.names, importNames.size) == importNames.size;
+  if(ok)
+    ok = dst.seek(0, fs::SeekSet) &&
+         dst.write((uint8_t *)&header, sizeof(header)) == sizeof(header);
+
+  if(src) src.close();
+  if(dst) dst.close();
+  free(runs);
+  free(mergeBuf);
+  return(ok? 0 : error? error : "Failed sorting schedule!");
 }
 
-char replace_accented_char(char c)
+//
+// Sort schedule records in given file by frequency and time, dropping
+// duplicate records coming from different transmitter sites, and
+// convert them to the compact file format. Returns an error message or
+// 0 on success.
+//
+static const char *eibiSortSchedule(const char *path)
 {
-  switch((unsigned char)c)
+  StationSchedule *buf = (StationSchedule *)malloc(EIBI_RUN_SIZE * sizeof(StationSchedule));
+  const char *error = "Out of memory!";
+  size_t total;
+
+  // Start with an empty name table
+  if(eibiNamesInit(&importNames) && buf)
   {
-    // Lowercase vowels with accents
-    case 0xE1: case 0xE0: case 0xE2: case 0xE3: case 0xE4: return 'a'; // á, à, â, ã, ä
-    case 0xE9: case 0xE8: case 0xEA: case 0xEB: return 'e';             // é, è, ê, ë
-    case 0xED: case 0xEC: case 0xEE: case 0xEF: return 'i';            // í, ì, î, ï
-    case 0xF3: case 0xF2: case 0xF4: case 0xF5: case 0xF6: return 'o';  // ó, ò, ô, õ, ö
-    case 0xFA: case 0xF9: case 0xFB: case 0xFC: return 'u';             // ú, ù, û, ü
-    // Uppercase vowels with accents
-    case 0xC1: case 0xC0: case 0xC2: case 0xC3: case 0xC4: return 'A';  // Á, À, Â, Ã, Ä
-    case 0xC9: case 0xC8: case 0xCA: case 0xCB: return 'E';             // É, È, Ê, Ë
-    case 0xCD: case 0xCC: case 0xCE: case 0xCF: return 'I';             // Í, Ì, Î, Ï
-    case 0xD3: case 0xD2: case 0xD4: case 0xD5: case 0xD6: return 'O';  // Ó, Ò, Ô, Õ, Ö
-    case 0xDA: case 0xD9: case 0xDB: case 0xDC: return 'U';             // Ú, Ù, Û, Ü
-    // Other special chars
-    case 0xF1: return 'n';  // ñ
-    case 0xD1: return 'N';  // Ñ
-    case 0xE7: return 'c';  // ç
-    case 0xC7: return 'C';  // Ç
-    default: return c;      // No change
+    int runCnt = eibiSortRuns(path, buf, &total);
+    error = runCnt < 0? "Failed sorting schedule!" : eibiMergeRuns(path, buf, total, runCnt);
   }
+
+  free(buf);
+  eibiNamesFree(&importNames);
+
+  LittleFS.remove(RUNS_PATH);
+  return(error);
 }
 
-static bool eibiParseLine(const char *line, StationSchedule &entry)
+//
+// Read validators of the saved schedule, return FALSE if there are none
+//
+static bool eibiReadMeta(EibiMeta *meta)
 {
-  char nameStr[sizeof(entry.name) + 1];
-  char freqStr[15] = {0};
-  char timeStr[10] = {0};
-  char tmpCol[12]  = {0};
-  char *p, *t;
-
-  // Scan line for data
-  if(sscanf(line, "%14c%9c%11c%24c", freqStr, timeStr, tmpCol, nameStr)<3)
-    return(false);
+  fs::File file = LittleFS.open(META_PATH, "rb");
+  bool ok = file && file.read((uint8_t *)meta, sizeof(*meta)) == sizeof(*meta);
+
+  if(file) file.close();
 
-  // Terminate found data
-  freqStr[14] = '\0';
-  timeStr[9] = '\0';
-  nameStr[24] = '\0';
-
-  // Parse frequency
-  entry.freq = (uint16_t)atof(freqStr);
-  if(!entry.freq) return(false);
-
-  // Parse time
-  int sh, sm, eh, em;
-  if(sscanf(timeStr, "%2d%2d-%2d%2d", &sh, &sm, &eh, &em) != 4) return(false);
-  entry.start_h = sh;
-  entry.start_m = sm;
-  entry.end_h   = eh;
-  entry.end_m   = em;
-
-  // Remove jammers
-  if(strstr(nameStr, "Jammer")) return(false);
-
-  // Remove leading and trailing white space from name
-  for(p = nameStr ; *p==' ' || *p=='\t' ; ++p);
-  for(t = p + strlen(p) - 1 ; t>=p && (*t==' ' || *t=='\t') ; *t--='\0');
-
-  // Replace accented characters
-  for (t = p; *t != '\0'; t++) {
-    *t = replace_accented_char(*t);
+  // Must match the current schedule format and have a schedule
+  ok = ok && meta->version == EIBI_VERSION && LittleFS.exists(EIBI_PATH);
+  if(ok)
+  {
+    meta->etag[sizeof(meta->etag) - 1] = '\0';
+    meta->modified[sizeof(meta->modified) - 1] = '\0';
   }
 
-  // Copy name
-  strncpy(entry.name, p, sizeof(entry.name) - 1);
-  entry.name[sizeof(entry.name)-1] = '\0';
+  return(ok);
+}
 
-  // Done
-  return(true);
+static bool eibiWriteMeta(const char *path, const EibiMeta *meta)
+{
+  fs::File file = LittleFS.open(path, "wb");
+  bool ok = file && file.write((const uint8_t *)meta, sizeof(*meta)) == sizeof(*meta);
+
+  if(file) file.close();
+  return(ok);
 }
 
-bool eibiLoadSchedule()
+//
+// Download schedule from EiBi site, convert it, and leave it in TEMP_PATH,
+// with its validators in MTMP_PATH. Runs in the loader task, reporting
+// progress via eibiStatus. Returns EIBI_DONE, EIBI_SAME, or EIBI_FAILED.
+//
+static uint8_t eibiDownload()
 {
-  static const char *eibiMessage = "Loading EiBi Schedule";
+  static const char *headers[] = { "ETag", "Last-Modified" };
   HTTPClient http;
+  EibiMeta oldMeta, meta;
+  bool haveMeta = eibiReadMeta(&oldMeta);
+  int code;
 
-  // Need to be connected to the network
-  if(getWiFiStatus() < 2) return(false);
-
-  drawScreen(eibiMessage, "Connecting...");
+  eibiStatus.message = "Connecting...";
 
-  // Open HTTP connection to EiBi site
+  // Open HTTP connection to EiBi site, only asking for the schedule
+  // if it has changed since the last download
   http.begin(EIBI_URL);
-  if(http.GET() != HTTP_CODE_OK)
+  http.collectHeaders(headers, 2);
+  if(haveMeta && oldMeta.etag[0]) http.addHeader("If-None-Match", oldMeta.etag);
+  if(haveMeta && oldMeta.modified[0]) http.addHeader("If-Modified-Since", oldMeta.modified);
+
+  code = http.GET();
+  if(code == HTTP_CODE_NOT_MODIFIED && haveMeta)
   {
-    drawScreen(eibiMessage, "Failed connecting to EiBi!");
+    eibiStatus.message = "Schedule is up to date";
     http.end();
-    return(false);
+    return(EIBI_SAME);
+  }
+  else if(code != HTTP_CODE_OK)
+  {
+    eibiStatus.message = "Failed connecting to EiBi!";
+    http.end();
+    return(EIBI_FAILED);
+  }
+
+  // Remember validators of the new schedule
+  memset(&meta, 0, sizeof(meta));
+  meta.version = EIBI_VERSION;
+  meta.hash    = EIBI_HASH_INIT;
+  strncpy(meta.etag, http.header("ETag").c_str(), sizeof(meta.etag) - 1);
+  strncpy(meta.modified, http.header("Last-Modified").c_str(), sizeof(meta.modified) - 1);
+
+  // Allocate network and file buffers
+  char *readBuf = (char *)malloc(EIBI_NET_SIZE + 1);
+  StationSchedule *writeBuf = (StationSchedule *)malloc(EIBI_WRITE_SIZE * sizeof(StationSchedule));
+  if(!readBuf || !writeBuf)
+  {
+    eibiStatus.message = "Out of memory!";
+    free(readBuf);
+    free(writeBuf);
+    http.end();
+    return(EIBI_FAILED);
   }
 
   // Open file in the local flash file system
   fs::File file = LittleFS.open(TEMP_PATH, "wb");
   if(!file)
   {
-    drawScreen(eibiMessage, "Failed opening local storage!");
+    eibiStatus.message = "Failed opening local storage!";
+    free(readBuf);
+    free(writeBuf);
     http.end();
-    return(false);
+    return(EIBI_FAILED);
   }
 
   // Start loading data
   WiFiClient *stream = http.getStreamPtr();
   int totalLen = http.getSize();
-  int byteCnt, lineCnt, charCnt;
-  char charBuf[200];
+  int byteCnt, lineCnt, readCnt, writeCnt;
+  bool skipLine = false;
+  bool ok = true;
+
+  eibiStatus.message = 0;
 
-  for(byteCnt = charCnt = lineCnt = 0 ; http.connected() && (totalLen<0 || byteCnt<totalLen) ; )
+  for(byteCnt = lineCnt = readCnt = writeCnt = 0 ; ok && (totalLen<0 || byteCnt<totalLen) ; )
   {
-    if(!stream->available()) delay(1);
-    else
+    int avail = stream->available();
+
+    // Wait for more data to arrive, stop when connection closes
+    if(avail <= 0)
     {
-      char c = stream->read();
-      byteCnt++;
+      if(!http.connected()) break;
+      delay(1);
+      continue;
+    }
 
-      if(c!='\n' && charCnt<sizeof(charBuf)-1) charBuf[charCnt++] = c;
-      else
-      {
-        char *p, *t;
+    // Read as much data as fits into the buffer
+    int n = stream->read((uint8_t *)readBuf + readCnt, EIBI_NET_SIZE - readCnt);
+    if(n <= 0) continue;
+    meta.hash = eibiHashBytes(meta.hash, (uint8_t *)readBuf + readCnt, n);
+    byteCnt += n;
+    readCnt += n;
+
+    // Go through all complete lines in the buffer
+    char *line = readBuf;
+    char *end  = readBuf + readCnt;
+    char *eol;
 
-        // Remove whitespace
-        charBuf[charCnt] = '\0';
-        for(p = charBuf ; *p && *p<=' ' ; ++p);
-        for(t = charBuf + charCnt - 1 ; t>=p && *t<=' ' ; *t--='\0');
+    while((eol = (char *)memchr(line, '\n', end - line)))
+    {
+      // Parse line unless it is the tail of an overly long line
+      if(!skipLine && eibiParseChunk(line, eol - line, &writeBuf[writeCnt]))
+      {
+        lineCnt++;
 
-        // If valid non-empty schedule line...
-        if(t-p+1>0 && isdigit(*p))
+        // Flush write buffer to the file when full
+        if(++writeCnt >= EIBI_WRITE_SIZE)
         {
-          // Remove LFs
-          for(t = p ; *t ; ++t)
-            if(*t=='\r') *t = ' ';
-
-          // If parsed a new entry...
-          StationSchedule entry;
-          if(eibiParseLine(p, entry))
-          {
-            // Write it to the output file
-            file.write((uint8_t*)&entry, sizeof(entry));
-            lineCnt++;
-
-            if(!(lineCnt & 31))
-            {
-              char statusMessage[64];
-              sprintf(statusMessage, "... %d bytes, %d entries ...", byteCnt, lineCnt);
-              drawScreen(eibiMessage, statusMessage);
-            }
-          }
+          ok = file.write((uint8_t *)writeBuf, writeCnt * sizeof(StationSchedule)) == writeCnt * sizeof(StationSchedule);
+          writeCnt = 0;
         }
-
-        // Done with the current buffer, start a new one
-        charCnt = 0;
-        if(c!='\n') charBuf[charCnt++] = c;
       }
+
+      skipLine = false;
+      line = eol + 1;
     }
+
+    // Keep incomplete line for the next read, drop it if it does not fit
+    readCnt = end - line;
+    if(readCnt >= EIBI_NET_SIZE) { readCnt = 0; skipLine = true; }
+    else if(readCnt && line != readBuf) memmove(readBuf, line, readCnt);
+
+    // Publish progress
+    eibiStatus.bytes   = byteCnt;
+    eibiStatus.entries = lineCnt;
+  }
+
+  // Parse the last line if it has no line feed
+  if(ok && readCnt && !skipLine && eibiParseChunk(readBuf, readCnt, &writeBuf[writeCnt]))
+  {
+    lineCnt++;
+    writeCnt++;
   }
 
-  // Done with file and HTTP connection
+  // Flush remaining records
+  if(ok && writeCnt)
+    ok = file.write((uint8_t *)writeBuf, writeCnt * sizeof(StationSchedule)) == writeCnt * sizeof(StationSchedule);
+
+  // Done with file, buffers, and HTTP connection
   file.close();
+  free(readBuf);
+  free(writeBuf);
   http.end();
 
-  // Move new schedule to its permanent place
-  LittleFS.remove(EIBI_PATH);
-  LittleFS.rename(TEMP_PATH, EIBI_PATH);
+  // Keep the old schedule if the new one could not be written
+  if(!ok)
+  {
+    LittleFS.remove(TEMP_PATH);
+    eibiStatus.message = "Failed writing local storage!";
+    return(EIBI_FAILED);
+  }
+
+  // Same content as the saved schedule, only update validators
+  if(haveMeta && meta.hash == oldMeta.hash)
+  {
+    LittleFS.remove(TEMP_PATH);
+    eibiWriteMeta(META_PATH, &meta);
+    eibiStatus.message = "Schedule is up to date";
+    return(EIBI_SAME);
+  }
+
+  // Sort new schedule by frequency and time
+  eibiStatus.entries = lineCnt;
+  eibiStatus.message = "Sorting...";
+  const char *error = eibiSortSchedule(TEMP_PATH);
+  if(error)
+  {
+    LittleFS.remove(TEMP_PATH);
+    eibiStatus.message = error;
+    return(EIBI_FAILED);
+  }
+
+  // Validators are installed together with the new schedule
+  if(!eibiWriteMeta(MTMP_PATH, &meta)) LittleFS.remove(MTMP_PATH);
 
   // Success
-  identifyFrequency(currentFrequency + currentBFO / 1000);
-  drawScreen(eibiMessage, "DONE!");
+  return(EIBI_DONE);
+}
+
+//
+// Schedule loader task, exits when done
+//
+static void eibiLoadTask(void *arg)
+{
+  // Report result to the main loop, which swaps files
+  eibiStatus.state = eibiDownload();
+  vTaskDelete(NULL);
+}
+
+//
+// Start loading schedule in background
+//
+bool eibiLoadSchedule()
+{
+  // Need to be connected to the network. The main loop has to be done
+  // with the last load (new schedule installed, final message shown).
+  if(getWiFiStatus() < 2 || eibiStatus.state != EIBI_IDLE) return(false);
+
+  eibiStatus.message = "Connecting...";
+  eibiStatus.bytes   = 0;
+  eibiStatus.entries = 0;
+  eibiStatus.state   = EIBI_LOADING;
+
+  if(xTaskCreate(eibiLoadTask, "EiBi", EIBI_TASK_STACK, NULL, 1, NULL) != pdPASS)
+  {
+    eibiStatus.message = "Failed starting loader!";
+    eibiStatus.state   = EIBI_FAILED;
+    return(false);
+  }
+
+  return(true);
+}
+
+//
+// Rename file over an existing one
+//
+static bool eibiReplace(const char *from, const char *to)
+{
+  if(LittleFS.rename(from, to)) return(true);
+  LittleFS.remove(to);
+  return(LittleFS.rename(from, to));
+}
+
+//
+// Called periodically from the main loop. Installs loaded schedule and
+// returns TRUE when the loading status needs to be redrawn.
+//
+bool eibiTickTime()
+{
+  static uint32_t lastEntries = 0;
+  static uint32_t lastTime = 0;
+  uint32_t now = millis();
+
+  switch(eibiStatus.state)
+  {
+    case EIBI_IDLE:
+      // Load schedule again if the saved one has been dropped
+      if(!eibiReimport || getWiFiStatus() < 2) return(false);
+      eibiReimport = false;
+      eibiLoadSchedule();
+      return(true);
+
+    case EIBI_LOADING:
+      // Redraw progress twice a second
+      if(now - lastTime < 500 || eibiStatus.entries == lastEntries) return(false);
+      lastEntries = eibiStatus.entries;
+      lastTime = now;
+      return(true);
+
+    case EIBI_DONE:
+      // Replace old schedule with the new one and index it. LittleFS
+      // renames over an existing file atomically.
+      eibiClose();
+      eibiReplace(TEMP_PATH, EIBI_PATH);
+      eibiOpen();
+
+      // Replace validators, dropping them if there are no new ones
+      if(!LittleFS.exists(MTMP_PATH) || !eibiReplace(MTMP_PATH, META_PATH))
+        LittleFS.remove(META_PATH);
+
+      identifyFrequency(currentFrequency + currentBFO / 1000);
+      eibiStatus.message = importNames.dropped? "DONE, some names dropped!" : "DONE!";
+      eibiStatus.state   = EIBI_SHOWING;
+      lastTime = now;
+      return(true);
+
+    case EIBI_SAME:
+    case EIBI_FAILED:
+      // Show final message for a while
+      eibiStatus.state = EIBI_SHOWING;
+      lastTime = now;
+      return(true);
+
+    case EIBI_SHOWING:
+      // Hide message after a while
+      if(now - lastTime < EIBI_MESSAGE_TIME) return(false);
+      eibiStatus.state = EIBI_IDLE;
+      return(true);
+  }
+
+  return(false);
+}
+
+//
+// Get status lines to show while loading schedule, returns FALSE if idle
+//
+bool eibiLoadStatus(const char **statusLine1, const char **statusLine2)
+{
+  static char statusMessage[64];
+  const char *message = eibiStatus.message;
+
+  if(eibiStatus.state == EIBI_IDLE) return(false);
+
+  if(!message)
+  {
+    sprintf(statusMessage, "... %lu bytes, %lu entries ...",
+      (unsigned long)eibiStatus.bytes, (unsigned long)eibiStatus.entries);
+    message = statusMessage;
+  }
+
+  *statusLine1 = "Loading EiBi Schedule";
+  *statusLine2 = message;
   return(true);
 }
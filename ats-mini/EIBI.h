@@ -20,9 +20,12 @@ struct StationSchedule
 
 bool eibiAvailable();
 bool eibiLoadSchedule();
+bool eibiTickTime();
+bool eibiLoadStatus(const char **statusLine1, const char **statusLine2);
+void eibiSetTime(uint8_t hour, uint8_t minute);
 const StationSchedule *eibiLookup(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset=NULL);
-const StationSchedule *eibiPrev(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset);
-const StationSchedule *eibiNext(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset);
+uint16_t eibiPrevFreq(uint16_t freq, uint8_t hour, uint8_t minute);
+uint16_t eibiNextFreq(uint16_t freq, uint8_t hour, uint8_t minute);
 const StationSchedule *eibiAtSameFreq(uint8_t hour, uint8_t minute, size_t *offset, bool same);
 
 #endif // EIBI_H
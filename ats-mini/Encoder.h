@@ -0,0 +1,93 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+#define ENCODER_QUEUE_SIZE  32  // Detents, must be a power of 2
+#define ENCODER_ACCEL_RESET 100 // Msecs between detents that stop acceleration
+
+//
+// Encoder detents, added by the interrupt handler and removed by the
+// main loop. Each side only writes its own index, so no locking needed.
+// A zero-filled queue is empty and ready to use.
+//
+typedef struct
+{
+  uint32_t time;          // Msecs when the detent happened
+  int8_t dir;             // +1 or -1
+} EncoderStep;
+
+typedef struct
+{
+  EncoderStep steps[ENCODER_QUEUE_SIZE];
+  volatile uint8_t head;  // Next detent to add, written by the handler
+  volatile uint8_t tail;  // Next detent to remove, written by the loop
+  uint32_t lastTime;      // Time of the last removed detent
+  int8_t lastDir;         // Direction of the last removed detent
+  uint32_t speed;         // Average msecs between detents
+} EncoderQueue;
+
+// Steps per detent, by average msecs between detents
+static const struct { uint8_t time; uint8_t steps; } encoderAccel[] =
+{
+  { 12, 8 }, { 20, 4 }, { 35, 2 },
+};
+
+//
+// Queue a detent in direction DIR at TIME, dropping it if the main
+// loop is too far behind. Always inlined, so that it runs from the
+// same memory as the interrupt handler.
+//
+static inline __attribute__((always_inline)) void encoderQueuePush(EncoderQueue *q, uint32_t time, int8_t dir)
+{
+  uint8_t head = q->head;
+
+  if(((head + 1) & (ENCODER_QUEUE_SIZE - 1)) == q->tail) return;
+
+  q->steps[head].time = time;
+  q->steps[head].dir  = dir;
+  q->head = (head + 1) & (ENCODER_QUEUE_SIZE - 1);
+}
+
+//
+// Return TRUE if there are queued detents
+//
+static inline bool encoderQueuePending(const EncoderQueue *q)
+{
+  return(q->head != q->tail);
+}
+
+//
+// Remove queued detents and return the net number of steps,
+// multiplied when the encoder spins fast and ACCEL is TRUE
+//
+static inline int encoderQueueDrain(EncoderQueue *q, bool accel)
+{
+  int result = 0;
+
+  while(q->tail != q->head)
+  {
+    const EncoderStep *step = &q->steps[q->tail];
+    uint32_t interval = step->time - q->lastTime;
+
+    // Average time between detents, restarted on direction change
+    // or a pause
+    if(step->dir != q->lastDir || interval >= ENCODER_ACCEL_RESET)
+      q->speed = ENCODER_ACCEL_RESET;
+    else
+      q->speed = (q->speed * 3 + interval) / 4;
+
+    int steps = 1;
+    for(unsigned j = 0 ; accel && j < sizeof(encoderAccel) / sizeof(encoderAccel[0]) ; j++)
+      if(q->speed < encoderAccel[j].time) { steps = encoderAccel[j].steps; break; }
+
+    result     += step->dir * steps;
+    q->lastTime = step->time;
+    q->lastDir  = step->dir;
+    q->tail     = (q->tail + 1) & (ENCODER_QUEUE_SIZE - 1);
+  }
+
+  return(result);
+}
+
+#endif // ENCODER_H
@@ -0,0 +1,71 @@
+#include "Common.h"
+#include "Encoder.h"
+
+// Main loop task, woken up by events
+static TaskHandle_t eventTask = 0;
+
+// Encoder detents, see Encoder.h
+static EncoderQueue encoderQueue;
+
+//
+// Called from the main loop task before other event functions
+//
+void eventInit()
+{
+  eventTask = xTaskGetCurrentTaskHandle();
+}
+
+//
+// Wake up the main loop from another task
+//
+void eventSignal()
+{
+  if(eventTask) xTaskNotifyGive(eventTask);
+}
+
+//
+// Wake up the main loop from an interrupt handler
+//
+ICACHE_RAM_ATTR void eventSignalFromISR()
+{
+  BaseType_t woken = pdFALSE;
+
+  if(eventTask) vTaskNotifyGiveFromISR(eventTask, &woken);
+  if(woken) portYIELD_FROM_ISR();
+}
+
+//
+// Sleep until an event or for MSECS at most
+//
+void eventWait(uint32_t msecs)
+{
+  if(eventTask)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(msecs));
+  else
+    delay(msecs);
+}
+
+//
+// Queue an encoder detent, called from the interrupt handler
+//
+ICACHE_RAM_ATTR void encoderPush(int8_t dir)
+{
+  encoderQueuePush(&encoderQueue, millis(), dir);
+}
+
+//
+// Return TRUE if there are queued encoder detents
+//
+bool encoderPending()
+{
+  return(encoderQueuePending(&encoderQueue));
+}
+
+//
+// Remove queued encoder detents and return the net number of steps,
+// multiplied when the encoder spins fast and ACCEL is TRUE
+//
+int encoderDrain(bool accel)
+{
+  return(encoderQueueDrain(&encoderQueue, accel));
+}
@@ -0,0 +1,37 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+
+//
+// Periodic jobs run by the main loop at their deadlines. Times are in
+// msecs as returned by millis(), all arithmetic is done on differences
+// so that the 49 day millis() wraparound does not matter.
+//
+typedef struct
+{
+  uint32_t period;        // Msecs between job runs
+  uint32_t last;          // Last time the job ran
+} Job;
+
+//
+// Return TRUE and start the next period if JOB is due at NOW
+//
+static inline bool jobDue(Job *job, uint32_t now)
+{
+  if(now - job->last < job->period) return(false);
+  job->last = now;
+  return(true);
+}
+
+//
+// Return msecs until JOB is due at NOW, but no more than WAIT
+//
+static inline uint32_t jobWait(const Job *job, uint32_t now, uint32_t wait)
+{
+  uint32_t elapsed = now - job->last;
+  uint32_t left = elapsed < job->period? job->period - elapsed : 0;
+  return(left < wait? left : wait);
+}
+
+#endif // JOBS_H
@@ -57,7 +57,7 @@ void drawLayoutDefault(const char *statusLine1, const char *statusLine2)
   drawSMeter(getStrength(rssi), METER_OFFSET_X, METER_OFFSET_Y);
 
   // Indicate FM pilot detection (stereo indicator)
-  drawStereoIndicator(METER_OFFSET_X, METER_OFFSET_Y, (currentMode==FM) && rx.getCurrentPilot());
+  drawStereoIndicator(METER_OFFSET_X, METER_OFFSET_Y, (currentMode==FM) && radioGetStatus().pilot);
 
   if(!drawWiFiStatus(statusLine1, statusLine2, STATUS_OFFSET_X, STATUS_OFFSET_Y))
   {
@@ -51,7 +51,15 @@ static void drawSmallScale(uint32_t freq, int y)
   const uint16_t scaleStart = 51;
   const uint16_t scaleEnd = 269;
 
-  for(int i=scaleStart+3; i<=scaleEnd-3; i+=2) spr.drawPixel(i, y, TH.scale_line);
+  for(int i=scaleStart+3; i<=scaleEnd-3; i+=2)
+  {
+    spr.drawPixel(i, y, TH.scale_line);
+
+    // Show band scan results, if any
+    uint32_t f = band->minimumFreq + (band->maximumFreq - band->minimumFreq) * (i - scaleStart) / (scaleEnd - scaleStart);
+    int rssi = 6 * scanGetRSSI(f, 2 * (band->maximumFreq - band->minimumFreq) / (scaleEnd - scaleStart));
+    if(rssi > 0) spr.drawFastVLine(i, y - 1 - rssi, rssi, rssi>4? TH.smeter_bar_plus:TH.smeter_bar);
+  }
   spr.drawCircle(scaleStart, y, 3, TH.scale_line);
   spr.drawCircle(scaleEnd, y, 3, TH.scale_line);
   spr.fillCircle(scaleStart + (scaleEnd-scaleStart) * (freq - band->minimumFreq) / (band->maximumFreq - band->minimumFreq), y, 3, TH.scale_pointer);
@@ -190,7 +198,7 @@ void drawLayoutSmeter(const char *statusLine1, const char *statusLine2)
   drawSideBar(currentCmd, ALT_MENU_OFFSET_X, ALT_MENU_OFFSET_Y, MENU_DELTA_X);
 
   // Indicate FM pilot detection (stereo indicator)
-  drawAltStereoIndicator(ALT_STEREO_OFFSET_X, ALT_STEREO_OFFSET_Y, (currentMode==FM) && rx.getCurrentPilot());
+  drawAltStereoIndicator(ALT_STEREO_OFFSET_X, ALT_STEREO_OFFSET_Y, (currentMode==FM) && radioGetStatus().pilot);
 
   if(!drawWiFiStatus(statusLine1, statusLine2, STATUS_OFFSET_X, STATUS_OFFSET_Y))
   {
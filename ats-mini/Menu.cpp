@@ -514,6 +514,11 @@ static void clickSeek(bool shortPress)
   if(shortPress) seekMode(true); else currentCmd = CMD_NONE;
 }
 
+static void clickScan(bool shortPress)
+{
+  if(shortPress) scanStart(10); else currentCmd = CMD_NONE;
+}
+
 static void doTheme(int dir)
 {
   themeIdx = wrap_range(themeIdx, dir, 0, getTotalThemes() - 1);
@@ -818,10 +823,10 @@ static void clickMenu(int cmd, bool shortPress)
       break;
 
     case MENU_SCAN:
-      // Run a band scan around current frequency with the same
-      // step as scale resolution (10kHz for AM, 100kHz for FM)
-      drawMessage("Scanning...");
-      scanRun(currentFrequency, 10);
+      // Start scanning the whole band with the same step as
+      // scale resolution (10kHz for AM, 100kHz for FM)
+      currentCmd = CMD_SCAN;
+      scanStart(10);
       break;
   }
 }
@@ -897,6 +902,7 @@ bool doSideBar(uint16_t cmd, int dir)
     case CMD_SCROLL:    doScrollDir(dir);break;
     case CMD_UTCOFFSET: doUTCOffset(scrollDirection * dir);break;
     case CMD_SQUELCH:   doSquelch(dir);break;
+    case CMD_SCAN:      scanZoom(dir);break;
     case CMD_ABOUT:     doAbout(dir);break;
     default:            return(false);
   }
@@ -916,6 +922,7 @@ bool clickHandler(uint16_t cmd, bool shortPress)
     case CMD_VOLUME:   clickVolume(shortPress);break;
     case CMD_SQUELCH:  clickSquelch(shortPress);break;
     case CMD_SEEK:     clickSeek(shortPress);break;
+    case CMD_SCAN:     clickScan(shortPress);break;
     case CMD_FREQ:     return(clickFreq(shortPress));
     default:           return(false);
   }
@@ -930,6 +937,9 @@ bool clickHandler(uint16_t cmd, bool shortPress)
 
 void selectBand(uint8_t idx, bool drawLoadingSSB)
 {
+  // Band scan would retune to the old band, its data is for the old band
+  scanClear();
+
   // Silence click on some hardware versions
   // https://github.com/esp32-si4732/ats-mini/discussions/103
   tempMuteOn(true);
@@ -975,8 +985,7 @@ static void drawCommon(const char *title, int x, int y, int sx, bool cursor = fa
   spr.setTextDatum(MC_DATUM);
 
   spr.setTextColor(TH.menu_hdr, TH.menu_bg);
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
+  drawSmoothBox(1+x, 1+y, 76+sx, 110, TH.menu_border, TH.menu_bg);
 
   spr.drawString(title, 40+x+(sx/2), 12+y, 2);
   spr.drawLine(1+x, 23+y, 76+sx, 23+y, TH.menu_border);
@@ -991,8 +1000,7 @@ static void drawMenu(int x, int y, int sx)
 {
   spr.setTextDatum(MC_DATUM);
 
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
+  drawSmoothBox(1+x, 1+y, 76+sx, 110, TH.menu_border, TH.menu_bg);
   spr.setTextColor(TH.menu_hdr, TH.menu_bg);
 
   spr.drawString("Menu", 40+x+(sx/2), 12+y, 2);
@@ -1020,8 +1028,7 @@ static void drawSettings(int x, int y, int sx)
 {
   spr.setTextDatum(MC_DATUM);
 
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
+  drawSmoothBox(1+x, 1+y, 76+sx, 110, TH.menu_border, TH.menu_bg);
   spr.setTextColor(TH.menu_hdr, TH.menu_bg);
   spr.drawString("Settings", 40+x+(sx/2), 12+y, 2);
   spr.drawLine(1+x, 23+y, 76+sx, 23+y, TH.menu_border);
@@ -1406,6 +1413,27 @@ static void drawCal(int x, int y, int sx)
   spr.drawString("Hz", 40+x+(sx/2), 90+y, 4);
 }
 
+static void drawScan(int x, int y, int sx)
+{
+  char text[8];
+
+  drawCommon(menu[MENU_SCAN], x, y, sx);
+  drawZoomedMenu(menu[MENU_SCAN]);
+  spr.setTextDatum(MC_DATUM);
+
+  spr.setTextColor(TH.menu_param, TH.menu_bg);
+  spr.drawString("Zoom", 40+x+(sx/2), 32+y, 2);
+  sprintf(text, "x%u", scanGetZoom());
+  spr.drawString(text, 40+x+(sx/2), 60+y, 4);
+
+  // Show progress while scanning
+  if(scanIsRunning())
+  {
+    sprintf(text, "%u%%", scanGetProgress());
+    spr.drawString(text, 40+x+(sx/2), 90+y, 4);
+  }
+}
+
 static void drawAvc(int x, int y, int sx)
 {
   drawCommon(menu[MENU_AVC], x, y, sx);
@@ -1497,8 +1525,7 @@ static void drawInfo(int x, int y, int sx)
   // Info box
   spr.setTextDatum(ML_DATUM);
   spr.setTextColor(TH.box_text, TH.box_bg);
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.box_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.box_bg);
+  drawSmoothBox(1+x, 1+y, 76+sx, 110, TH.box_border, TH.box_bg);
 
   spr.drawString("Step:", 6+x, 64+y+(-3*16), 2);
   spr.drawString(getCurrentStep()->desc, 48+x, 64+y+(-3*16), 2);
@@ -1597,6 +1624,7 @@ void drawSideBar(uint16_t cmd, int x, int y, int sx)
     case CMD_SCROLL:    drawScrollDir(x, y, sx); break;
     case CMD_UTCOFFSET: drawUTCOffset(x, y, sx); break;
     case CMD_SQUELCH:   drawSquelch(x, y, sx);   break;
+    case CMD_SCAN:      drawScan(x, y, sx);      break;
     default:            drawInfo(x, y, sx);      break;
   }
 }
@@ -41,6 +41,32 @@ Preferences preferences;
 // AsyncWebServer object on port 80
 AsyncWebServer server(80);
 
+// WebSocket streaming screen changes to the /screen page
+#define MIRROR_TIME 250    // Minimal msecs between screen updates sent
+#define MIRROR_SIZE 16384  // Maximal screen update size (bytes)
+AsyncWebSocket webSocket("/screen/ws");
+static CaptureState webMirror;
+static uint32_t webMirrorTime = 0;
+
+// Set by the web server task when a client connects, the next screen
+// update then sends the whole screen
+static volatile bool webMirrorReset = false;
+
+// Settings from the config page, saved by the web server task and
+// applied by the main loop
+static volatile bool webConfigPending = false;
+static int webConfigUtcOffset;
+static int webConfigTheme;
+static int8_t webConfigScroll;
+static bool webConfigZoom;
+static bool webConfigConnect;
+
+// Screen capture being collected, sent as a single WebSocket message
+static uint8_t *webFrame = 0;
+static size_t webFrameSize = 0;
+static size_t webFrameAlloc = 0;
+static bool webFrameFailed = false;
+
 // NTP Client to get time
 WiFiUDP ntpUDP;
 NTPClient ntpClient(ntpUDP, "pool.ntp.org");
@@ -48,8 +74,11 @@ NTPClient ntpClient(ntpUDP, "pool.ntp.org");
 static bool wifiInitAP();
 static bool wifiConnect();
 static void webInit();
+static void webSocketWrite(const uint8_t *data, size_t size);
+static bool webSocketReady();
 
 static void webSetConfig(AsyncWebServerRequest *request);
+static void webApplyConfig();
 static void webReadEEPROM(AsyncWebServerRequest *request);
 static void webWriteEEPROM(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool lastChunk);
 
@@ -61,6 +90,7 @@ static const String webThemeSelector();
 static const String webRadioPage();
 static const String webMemoryPage();
 static const String webConfigPage();
+static const String webScreenPage();
 
 //
 // Delayed WiFi connection
@@ -80,6 +110,49 @@ void netTickTime()
     connectTime = millis();
     itIsTimeToWiFi = false;
   }
+
+  // Apply settings from the config page
+  if(webConfigPending)
+  {
+    webConfigPending = false;
+    webApplyConfig();
+  }
+
+  // Stream screen changes to web clients, at a limited rate, skipping
+  // updates while any client has not sent out the previous ones yet
+  if(webSocket.count() && (millis() - webMirrorTime >= MIRROR_TIME) && webSocketReady())
+  {
+    webMirrorTime = millis();
+    webFrameSize = 0;
+    webFrameFailed = false;
+
+    if(webMirrorReset)
+    {
+      webMirrorReset = false;
+      webMirror.valid = false;
+    }
+
+    // Large updates are sent in parts, MIRROR_SIZE bytes at a time
+    if(drawCapture(&webMirror, CAPTURE_CHANGES, webSocketWrite, MIRROR_SIZE))
+    {
+      // Send the whole capture at once, or the whole screen next
+      // time if it did not fit into memory
+      if(!webFrameFailed)
+        webSocket.binaryAll(webFrame, webFrameSize);
+      else
+        webMirror.valid = false;
+    }
+
+    webSocket.cleanupClients();
+  }
+
+  // Free capture buffer when nobody is watching
+  if(!webSocket.count() && webFrame)
+  {
+    free(webFrame);
+    webFrame = 0;
+    webFrameAlloc = 0;
+  }
 }
 
 //
@@ -321,6 +394,49 @@ static bool wifiConnect()
   }
 }
 
+//
+// Collect a piece of the screen capture into webFrame
+//
+static void webSocketWrite(const uint8_t *data, size_t size)
+{
+  if(webFrameFailed) return;
+
+  // Grow the buffer as needed, it is kept for the next captures
+  if(webFrameSize + size > webFrameAlloc)
+  {
+    size_t alloc = (webFrameSize + size + 4095) & ~4095;
+    uint8_t *frame = (uint8_t *)realloc(webFrame, alloc);
+    if(!frame)
+    {
+      webFrameFailed = true;
+      return;
+    }
+
+    webFrame = frame;
+    webFrameAlloc = alloc;
+  }
+
+  memcpy(webFrame + webFrameSize, data, size);
+  webFrameSize += size;
+}
+
+//
+// Return TRUE if all clients can take another screen update
+//
+static bool webSocketReady()
+{
+  for(auto &client : webSocket.getClients())
+    if(client.status()==WS_CONNECTED && client.queueIsFull()) return(false);
+
+  return(true);
+}
+
+static void webSocketEvent(AsyncWebSocket *ws, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  // Send the whole screen when someone connects
+  if(type==WS_EVT_CONNECT) webMirrorReset = true;
+}
+
 //
 // Initialize internal web server
 //
@@ -341,6 +457,14 @@ static void webInit()
     request->send(200, "text/html", webConfigPage());
   });
 
+  server.on("/screen", HTTP_ANY, [] (AsyncWebServerRequest *request) {
+    request->send(200, "text/html", webScreenPage());
+  });
+
+  // Screen changes are streamed via this WebSocket
+  webSocket.onEvent(webSocketEvent);
+  server.addHandler(&webSocket);
+
   server.onNotFound([] (AsyncWebServerRequest *request) {
     request->send(404, "text/plain", "Not found");
   });
@@ -363,8 +487,6 @@ static void webInit()
 
 void webSetConfig(AsyncWebServerRequest *request)
 {
-  bool eepromSave = false;
-
   // Start modifying preferences
   preferences.begin("configData", false);
 
@@ -397,40 +519,49 @@ void webSetConfig(AsyncWebServerRequest *request)
     }
   }
 
+  // Done with the preferences
+  preferences.end();
+
+  // Time zone, theme, scroll direction and menu zoom are used by the
+  // main loop, let it apply them
+  webConfigUtcOffset = request->hasParam("utcoffset", true)?
+    request->getParam("utcoffset", true)->value().toInt() : -1;
+  webConfigTheme = request->hasParam("theme", true)?
+    request->getParam("theme", true)->value().toInt() : -1;
+  webConfigScroll  = request->hasParam("scroll", true)? -1 : 1;
+  webConfigZoom    = request->hasParam("zoom", true);
+  webConfigConnect = haveSSID;
+  webConfigPending = true;
+
+  // Show config page again
+  request->redirect("/config");
+}
+
+//
+// Apply settings from the config page, called from the main loop
+//
+static void webApplyConfig()
+{
   // Save time zone
-  if(request->hasParam("utcoffset", true))
+  if(webConfigUtcOffset >= 0)
   {
-    String utcOffset = request->getParam("utcoffset", true)->value();
-    utcOffsetIdx = utcOffset.toInt();
+    utcOffsetIdx = webConfigUtcOffset;
     clockRefreshTime();
-    eepromSave = true;
   }
 
   // Save theme
-  if(request->hasParam("theme", true))
-  {
-    String theme = request->getParam("theme", true)->value();
-    themeIdx = theme.toInt();
-    eepromSave = true;
-  }
+  if(webConfigTheme >= 0) themeIdx = webConfigTheme;
 
   // Save scroll direction and menu zoom
-  scrollDirection = request->hasParam("scroll", true)? -1 : 1;
-  zoomMenu        = request->hasParam("zoom", true);
-  eepromSave = true;
-
-  // Done with the preferences
-  preferences.end();
+  scrollDirection = webConfigScroll;
+  zoomMenu        = webConfigZoom;
 
   // Save EEPROM immediately
-  if(eepromSave) eepromRequestSave(true);
-
-  // Show config page again
-  request->redirect("/config");
+  eepromRequestSave(true);
 
   // If we are currently in AP mode, and infrastructure mode requested,
   // and there is at least one SSID / PASS pair, request network connection
-  if(haveSSID && (wifiModeIdx>NET_AP_ONLY) && (WiFi.status()!=WL_CONNECTED))
+  if(webConfigConnect && (wifiModeIdx>NET_AP_ONLY) && (WiFi.status()!=WL_CONNECTED))
     netRequestConnect();
 }
 
@@ -611,6 +742,7 @@ static const String webRadioPage()
 "<H1>ATS-Mini Pocket Receiver</H1>"
 "<P ALIGN='CENTER'>"
   "<A HREF='/memory'>Memory</A>&nbsp;|&nbsp;<A HREF='/config'>Config</A>"
+  "&nbsp;|&nbsp;<A HREF='/screen'>Screen</A>"
 "</P>"
 "<TABLE COLUMNS=2>"
 "<TR>"
@@ -643,12 +775,63 @@ static const String webRadioPage()
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Battery Voltage</TD>"
-  "<TD>" + String(batteryMonitor()) + "V</TD>"
+  "<TD>" + String(batteryGetVoltage()) + "V</TD>"
 "</TR>"
 "</TABLE>"
 );
 }
 
+//
+// Screen mirror, decoding captures sent via WebSocket (see
+// tools/screenshot.py for the format). Each message is a whole
+// capture, deltas without a base are drawn over a blank screen,
+// anything else is dropped.
+//
+static const String webScreenPage()
+{
+  return webPage(
+"<H1>ATS-Mini Screen</H1>"
+"<P ALIGN='CENTER'>"
+  "<A HREF='/'>Status</A>&nbsp;|&nbsp;<A HREF='/memory'>Memory</A>"
+"</P>"
+"<P ALIGN='CENTER'><CANVAS ID='screen' WIDTH='320' HEIGHT='170'></CANVAS></P>"
+"<SCRIPT>"
+"var ctx = document.getElementById('screen').getContext('2d');"
+"var img = null;"
+"function decode(b) {"
+  "if(b.length < 10 || b[0] != 65 || b[1] != 84 || b[2] != 83 || b[3] != 67 || b[4] != 1) return false;"
+  "var w = b[6] | b[7] << 8, h = b[8] | b[9] << 8, p = 10, delta = b[5] & 1;"
+  "if(!w || !h || w > 1024 || h > 1024) return false;"
+  "if(img && (img.width != w || img.height != h)) img = null;"
+  "var out = delta && img ? new ImageData(new Uint8ClampedArray(img.data), w, h) : ctx.createImageData(w, h);"
+  "for(var y = 0; y < h; y++) {"
+    "if(p >= b.length) return false;"
+    "if(!b[p++]) continue;"
+    "for(var x = 0; x < w;) {"
+      "if(p >= b.length) return false;"
+      "var n = b[p++], run = n & 128, k = (n & 127) + 1;"
+      "if(p + (run ? 2 : 2 * k) > b.length || x + k > w) return false;"
+      "for(var j = 0; j < k; j++, x++) {"
+        "var v = b[p] | b[p + 1] << 8, i = (y * w + x) * 4;"
+        "out.data[i] = (v >> 8) & 248; out.data[i + 1] = (v >> 3) & 252;"
+        "out.data[i + 2] = (v << 3) & 248; out.data[i + 3] = 255;"
+        "if(!run) p += 2;"
+      "}"
+      "if(run) p += 2;"
+    "}"
+  "}"
+  "if(p != b.length) return false;"
+  "img = out;"
+  "ctx.putImageData(img, 0, 0);"
+  "return true;"
+"}"
+"var ws = new WebSocket('ws://' + location.host + '/screen/ws');"
+"ws.binaryType = 'arraybuffer';"
+"ws.onmessage = function(e) { decode(new Uint8Array(e.data)); };"
+"</SCRIPT>"
+);
+}
+
 static const String webMemoryPage()
 {
   String items = "";
@@ -0,0 +1,174 @@
+#include "Common.h"
+
+#define RADIO_STATUS_TIME  200 // Msecs between signal quality checks
+#define RADIO_RDS_TIME     250 // Msecs between RDS checks
+
+// The radio task polls SI4732 status and applies tuning requests
+// while the main loop draws the screen or waits for events. Both
+// access the receiver only while holding radioMutex.
+static SemaphoreHandle_t radioMutex = 0;
+static TaskHandle_t radioTaskHandle = 0;
+
+// Pending tuning request, requests are counted to tell the status
+// measured at the current frequency from an older one
+static volatile bool radioTunePending = false;
+static volatile uint16_t radioTuneFreq;
+static volatile uint32_t radioTuneCount = 0;
+static uint32_t radioTunedCount = 0;
+
+// Status snapshots, the radio task writes one while the other is read
+static RadioStatus radioStatus[2] = { 0 };
+static uint32_t radioStatusTune[2] = { 0 };
+static volatile uint8_t radioStatusIdx = 0;
+static volatile bool radioRdsPending = false;
+
+//
+// Take exclusive access to the receiver, may be nested
+//
+void radioLock()
+{
+  if(radioMutex) xSemaphoreTakeRecursive(radioMutex, portMAX_DELAY);
+}
+
+//
+// Release exclusive access to the receiver
+//
+void radioUnlock()
+{
+  if(radioMutex) xSemaphoreGiveRecursive(radioMutex);
+}
+
+//
+// Request tuning to FREQ, the radio task does it in background
+//
+void radioTune(uint16_t freq)
+{
+  radioTuneFreq = freq;
+  radioTuneCount++;
+  radioTunePending = true;
+
+  // RDS data read so far belongs to the old frequency
+  radioRdsPending = false;
+
+  if(radioTaskHandle)
+    xTaskNotifyGive(radioTaskHandle);
+  else
+    radioSync();
+}
+
+//
+// Wake up the radio task, called when band scan stops
+//
+void radioWake()
+{
+  if(radioTaskHandle) xTaskNotifyGive(radioTaskHandle);
+}
+
+//
+// Apply pending tuning request now. Must be called before talking
+// to the receiver in a way that depends on its frequency.
+//
+void radioSync()
+{
+  radioLock();
+  if(radioTunePending)
+  {
+    radioTunePending = false;
+    uint32_t count = radioTuneCount;
+    rx.setFrequency(radioTuneFreq);
+    radioTunedCount = count;
+    radioRdsPending = false;
+  }
+  radioUnlock();
+}
+
+//
+// Get the latest receiver status
+//
+RadioStatus radioGetStatus()
+{
+  uint8_t idx = radioStatusIdx;
+  RadioStatus result = radioStatus[idx];
+
+  // Measured before the last tuning request
+  result.stale = radioStatusTune[idx] != radioTuneCount;
+  return(result);
+}
+
+//
+// Return TRUE once when new RDS data can be processed
+//
+bool radioRdsReady()
+{
+  bool result = radioRdsPending;
+  radioRdsPending = false;
+  return(result);
+}
+
+static void radioPoll()
+{
+  RadioStatus *status = &radioStatus[radioStatusIdx ^ 1];
+
+  radioStatusTune[radioStatusIdx ^ 1] = radioTunedCount;
+
+  rx.getCurrentReceivedSignalQuality();
+  status->rssi  = rx.getCurrentRSSI();
+  status->snr   = rx.getCurrentSNR();
+  status->pilot = rx.getCurrentPilot();
+
+  // Use rx.getFrequency to force read of capacitor value from SI4732/5
+  rx.getFrequency();
+  status->capacitor = rx.getAntennaTuningCapacitor();
+
+  radioStatusIdx ^= 1;
+}
+
+static void radioTask(void *arg)
+{
+  Job statusJob = { RADIO_STATUS_TIME, millis() };
+  Job rdsJob    = { RADIO_RDS_TIME, millis() };
+
+  while(true)
+  {
+    uint32_t wait = jobWait(&statusJob, millis(), RADIO_RDS_TIME);
+    wait = jobWait(&rdsJob, millis(), wait);
+
+    // Band scan takes its own measurements, so only tuning requests
+    // and the end of the scan wake the task up while scanning
+    ulTaskNotifyTake(pdTRUE, scanIsRunning()? portMAX_DELAY : pdMS_TO_TICKS(wait));
+
+    radioLock();
+    radioSync();
+
+    if(!scanIsRunning())
+    {
+      if(jobDue(&statusJob, millis()))
+      {
+        radioPoll();
+        eventSignal();
+      }
+
+      // RDS data is processed in the main loop
+      if(jobDue(&rdsJob, millis()) && currentMode==FM && radioGetStatus().snr >= 12)
+      {
+        rx.getRdsStatus();
+        radioRdsPending = true;
+        eventSignal();
+      }
+    }
+
+    radioUnlock();
+  }
+}
+
+//
+// Start the radio task, once the receiver is set up
+//
+void radioInit()
+{
+  radioPoll();
+
+  radioMutex = xSemaphoreCreateRecursiveMutex();
+  if(radioMutex)
+    xTaskCreatePinnedToCore(radioTask, "radio", 4096, 0, 1, &radioTaskHandle, 0);
+}
@@ -3,12 +3,18 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "Storage.h"
 
 #ifndef DISABLE_REMOTE
 
+#define MIRROR_TIME 200 // Minimal msecs between screen updates sent
+
 static uint32_t remoteTimer = millis();
 static uint8_t remoteSeqnum = 0;
 static bool remoteLogOn = false;
+static bool remoteMirrorOn = false;
+static uint32_t remoteMirrorTime = 0;
+static CaptureState remoteMirror;
 
 static uint8_t char2nibble(char key)
 {
@@ -127,6 +133,56 @@ static bool showError(const char *message)
   return false;
 }
 
+static void remoteWrite(const uint8_t *data, size_t size)
+{
+  Serial.write(data, size);
+}
+
+static void remoteCaptureBinary(bool delta)
+{
+  static CaptureState state = { 0 };
+  if(!drawCapture(&state, delta? CAPTURE_DELTA : CAPTURE_FULL, remoteWrite))
+    showError("Screenshot not available");
+}
+
+static void remoteGetDrawStats()
+{
+  DrawStats stats = drawGetStats(true);
+  EepromStats eeprom = eepromGetStats(true);
+  ScanStats scan = scanGetStats(true);
+
+  Serial.printf(
+    "Frames: %lu, merged: %lu, average: %luus, longest: %luus\r\n",
+    stats.frames, stats.dropped,
+    stats.frames? stats.total / stats.frames : 0, stats.longest
+  );
+
+  // Compare with a DISABLE_GLYPHS build to see what glyphs save
+  Serial.printf(
+    "Frequency draws: %lu, average: %luus\r\n",
+    stats.freqDraws, stats.freqDraws? stats.freqTime / stats.freqDraws : 0
+  );
+
+  // Saves without changes should not commit anything
+  Serial.printf(
+    "EEPROM saves: %lu, commits: %lu, bytes written: %lu\r\n",
+    eeprom.saves, eeprom.commits, eeprom.bytes
+  );
+
+  // Time per frequency includes tuning, dwelling on carriers, and the
+  // main loop work done between scan steps
+  if(scan.sweeps) Serial.printf(
+    "Scans: %lu, frequencies: %lu, carriers: %lu, timeouts: %lu, average: %luus per frequency\r\n",
+    scan.sweeps, scan.bins, scan.dwells, scan.timeouts,
+    scan.bins? scan.time / scan.bins : 0
+  );
+
+#if DEBUG
+  // Rounded boxes differing from fillSmoothRoundRect(), should be 0
+  Serial.printf("Wrong box pixels: %lu\r\n", stats.boxes);
+#endif
+}
+
 static void remoteGetMemories()
 {
   for (uint8_t i = 0; i < getTotalMemories(); i++) {
@@ -278,14 +334,11 @@ void remotePrintStatus()
   // Prepare information ready to be sent
   float remoteVoltage = batteryMonitor();
 
-  // S-Meter conditional on compile option
-  rx.getCurrentReceivedSignalQuality();
-  uint8_t remoteRssi = rx.getCurrentRSSI();
-  uint8_t remoteSnr = rx.getCurrentSNR();
-
-  // Use rx.getFrequency to force read of capacitor value from SI4732/5
-  rx.getFrequency();
-  uint16_t tuningCapacitor = rx.getAntennaTuningCapacitor();
+  // Latest receiver status, as read by the radio task
+  RadioStatus status = radioGetStatus();
+  uint8_t remoteRssi = status.rssi;
+  uint8_t remoteSnr = status.snr;
+  uint16_t tuningCapacitor = status.capacitor;
 
   // Remote serial
   Serial.printf("%u,%u,%d,%d,%s,%s,%s,%s,%hu,%hu,%hu,%hu,%hu,%.2f,%hu\r\n",
@@ -320,6 +373,13 @@ void remoteTickTime()
     // Show status
     remotePrintStatus();
   }
+
+  // Stream screen changes to the remote, at a limited rate
+  if(remoteMirrorOn && (millis() - remoteMirrorTime >= MIRROR_TIME))
+  {
+    remoteMirrorTime = millis();
+    drawCapture(&remoteMirror, CAPTURE_CHANGES, remoteWrite);
+  }
 }
 
 //
@@ -414,10 +474,32 @@ int remoteDoCommand(char key)
       break;
     case 'C':
       remoteLogOn = false;
+#ifdef ENABLE_STRIPS
+      // Only a strip of the screen is kept in memory
+      showError("Screenshot not available");
+#else
       remoteCaptureScreen();
+#endif
+      break;
+    case 'c':
+      remoteLogOn = false;
+      remoteCaptureBinary(false);
+      break;
+    case 'd':
+      remoteLogOn = false;
+      remoteCaptureBinary(true);
+      break;
+    case 'D':
+      remoteLogOn = false;
+      remoteMirrorOn = !remoteMirrorOn;
+      remoteMirror.valid = false;
       break;
     case 't':
       remoteLogOn = !remoteLogOn;
+      remoteMirrorOn = false;
+      break;
+    case 'F':
+      remoteGetDrawStats();
       break;
 
     case '$':
@@ -2,133 +2,402 @@
 #include "Utils.h"
 #include "Menu.h"
 
-#define SCAN_TIME   100 // Msecs between tuning and reading RSSI
-#define SCAN_POINTS 200 // Number of frequencies to scan
+#define SCAN_TIME   100 // Maximum msecs between tuning and reading RSSI
+#define SCAN_DWELL  60  // Extra msecs to spend measuring possible carriers
+#define SCAN_POINTS 2048 // Maximum number of frequencies to scan
+#define SCAN_COARSE 4   // Coarse pass measures every SCAN_COARSE-th frequency
+#define SCAN_CARRIER 1  // Minimal SNR level of a possible carrier
+#define SCAN_PEAK   2   // Minimal RSSI level above noise of a possible carrier
+#define SCAN_REDRAW 100 // Msecs between redraws while scanning
 
 #define SCAN_OFF    0   // Scanner off, no data
 #define SCAN_RUN    1   // Scanner running
 #define SCAN_DONE   2   // Scanner done, valid data in scanData[]
 
-static struct
-{
-  uint8_t rssi;
-  uint8_t snr;
-} scanData[SCAN_POINTS];
+#define SCAN_TUNE    0  // Tune to the next frequency
+#define SCAN_SETTLE  1  // Wait for tuning to complete
+#define SCAN_MEASURE 2  // Measure a possible carrier once more
+
+#define SCAN_COARSE_PASS 0 // Measuring every SCAN_COARSE-th frequency
+#define SCAN_REFINE_PASS 1 // Measuring frequencies next to possible carriers
+
+// Scan results are quantized to a byte: RSSI level in the high nibble
+// (0 = not measured yet) and SNR level in the low nibble
+#define SCAN_RSSI(d) ((d) >> 4)
+#define SCAN_SNR(d)  ((d) & 0x0F)
+
+static uint8_t scanData[SCAN_POINTS];
+static ScanStats scanStats = { 0 };
+static uint32_t scanStartTime = 0;
 
 static uint32_t scanTime = millis();
+static uint32_t scanDrawTime = 0;
 static uint8_t  scanStatus = SCAN_OFF;
+static uint8_t  scanPhase  = SCAN_TUNE;
+static uint8_t  scanPass   = SCAN_COARSE_PASS;
 
+static uint16_t scanVersion = 0;
 static uint16_t scanStartFreq;
+static uint16_t scanSavedFreq;
 static uint16_t scanStep;
 static uint16_t scanCount;
+static uint16_t scanIdx;
 static uint8_t  scanMinRSSI;
 static uint8_t  scanMaxRSSI;
 static uint8_t  scanMinSNR;
 static uint8_t  scanMaxSNR;
 
+// Scale zoom levels, in scan steps per scale division
+static const uint8_t scanZooms[] = { 1, 2, 5, 10, 20, 50, 100 };
+static uint8_t scanZoomIdx = 0;
+
 static inline uint8_t min(uint8_t a, uint8_t b) { return(a<b? a:b); }
 static inline uint8_t max(uint8_t a, uint8_t b) { return(a>b? a:b); }
 
-float scanGetRSSI(uint16_t freq)
+//
+// Find stored results covering [freq - span/2, freq + span/2)
+//
+static bool scanGetRange(uint16_t freq, uint16_t span, int *first, int *last)
 {
+  // Must have some data
+  if(scanStatus==SCAN_OFF) return(false);
+
+  // Cover at least one stored frequency
+  span = span > scanStep? span : scanStep;
+
+  int from = (int)freq - span / 2 - scanStartFreq;
+  int to   = (int)freq + (span + 1) / 2 - scanStartFreq;
+
+  *first = from < 0? 0 : (from + scanStep - 1) / scanStep;
+  *last  = to <= 0? -1 : (to - 1) / scanStep;
+  *last  = *last < scanCount? *last : scanCount - 1;
+
+  return(*first <= *last);
+}
+
+float scanGetRSSI(uint16_t freq, uint16_t span)
+{
+  uint8_t result = 0;
+  int first, last;
+
   // Input frequency must be in range of existing data
-  if((scanStatus!=SCAN_DONE) || (freq<scanStartFreq) || (freq>=scanStartFreq+scanStep*scanCount))
-    return(0.0);
+  if(!scanGetRange(freq, span, &first, &last)) return(0.0);
 
-  uint8_t result = scanData[(freq - scanStartFreq) / scanStep].rssi;
+  // Use the strongest measured signal in range
+  for(int j=first ; j<=last ; j++)
+    result = max(SCAN_RSSI(scanData[j]), result);
+
+  // Nothing measured yet, or range not known yet
+  if(!result || scanMinRSSI > scanMaxRSSI) return(0.0);
   return((result - scanMinRSSI) / (float)(scanMaxRSSI - scanMinRSSI + 1));
 }
 
-float scanGetSNR(uint16_t freq)
+float scanGetSNR(uint16_t freq, uint16_t span)
 {
+  uint8_t result = 0;
+  bool measured = false;
+  int first, last;
+
   // Input frequency must be in range of existing data
-  if((scanStatus!=SCAN_DONE) || (freq<scanStartFreq) || (freq>=scanStartFreq+scanStep*scanCount))
-    return(0.0);
+  if(!scanGetRange(freq, span, &first, &last)) return(0.0);
 
-  uint8_t result = scanData[(freq - scanStartFreq) / scanStep].snr;
+  // Use the best measured signal in range
+  for(int j=first ; j<=last ; j++)
+    if(SCAN_RSSI(scanData[j]))
+    {
+      result = max(SCAN_SNR(scanData[j]), result);
+      measured = true;
+    }
+
+  // Nothing measured yet, or range not known yet
+  if(!measured || scanMinSNR > scanMaxSNR) return(0.0);
   return((result - scanMinSNR) / (float)(scanMaxSNR - scanMinSNR + 1));
 }
 
-static void scanInit(uint16_t centerFreq, uint16_t step)
+//
+// Return scale zoom, only applied in the scan menu and while there is
+// scan data to show on the scale
+//
+uint8_t scanGetZoom()
+{
+  return(scanStatus!=SCAN_OFF || currentCmd==CMD_SCAN? scanZooms[scanZoomIdx] : scanZooms[0]);
+}
+
+void scanZoom(int dir)
 {
-  scanStep    = step;
-  scanCount   = 0;
-  scanMinRSSI = 255;
-  scanMaxRSSI = 0;
-  scanMinSNR  = 255;
-  scanMaxSNR  = 0;
-  scanStatus  = SCAN_RUN;
-  scanTime    = millis();
+  int idx = scanZoomIdx + dir;
+  scanZoomIdx = idx < 0? 0 : idx > (int)LAST_ITEM(scanZooms)? LAST_ITEM(scanZooms) : idx;
+}
+
+//
+// Return a number that changes whenever scan data changes
+//
+uint16_t scanGetVersion()
+{
+  return(scanVersion);
+}
 
+//
+// Return scan timing statistics, optionally starting over
+//
+ScanStats scanGetStats(bool reset)
+{
+  ScanStats result = scanStats;
+  if(reset) scanStats = (ScanStats){ 0 };
+  return(result);
+}
+
+//
+// Return scan progress in percent
+//
+uint8_t scanGetProgress()
+{
+  if(scanStatus!=SCAN_RUN) return(scanStatus==SCAN_DONE? 100 : 0);
+  return((scanPass * scanCount + scanIdx) * 100 / (2 * scanCount));
+}
+
+static void scanInit(uint16_t step)
+{
   const Band *band = getCurrentBand();
-  int freq = scanStep * (centerFreq / scanStep - SCAN_POINTS / 2);
 
-  // Adjust to band boundaries
-  if(freq + scanStep * (SCAN_POINTS - 1) > band->maximumFreq)
-    freq = band->maximumFreq - scanStep * (SCAN_POINTS - 1);
-  if(freq < band->minimumFreq)
-    freq = band->minimumFreq;
-  scanStartFreq = freq;
+  // Use larger step if the band does not fit into the buffer
+  scanStep = step * ((band->maximumFreq - band->minimumFreq) / (step * (SCAN_POINTS - 1)) + 1);
+
+  // Cover the whole band
+  scanStartFreq = (band->minimumFreq + scanStep - 1) / scanStep * scanStep;
+  scanCount     = (band->maximumFreq - scanStartFreq) / scanStep + 1;
+  scanIdx       = 0;
+  scanPass      = SCAN_COARSE_PASS;
+  scanMinRSSI   = 255;
+  scanMaxRSSI   = 0;
+  scanMinSNR    = 255;
+  scanMaxSNR    = 0;
+  scanStatus    = SCAN_RUN;
+  scanPhase     = SCAN_TUNE;
+  scanTime      = millis();
+  scanStartTime = micros();
 
   // Clear scan data
   memset(scanData, 0, sizeof(scanData));
+  scanVersion++;
+}
+
+//
+// Check if a coarse pass result looks like a carrier
+//
+static bool scanIsPeak(int idx)
+{
+  if(idx < 0 || idx >= scanCount || !SCAN_RSSI(scanData[idx])) return(false);
+
+  return(
+    SCAN_SNR(scanData[idx]) >= SCAN_CARRIER ||
+    SCAN_RSSI(scanData[idx]) >= scanMinRSSI + SCAN_PEAK
+  );
 }
 
-static bool scanTickTime()
+//
+// Find next frequency to scan, starting with scanIdx, return FALSE
+// when done
+//
+static bool scanFindNext()
 {
-  // Scan must be on
-  if((scanStatus!=SCAN_RUN) || (scanCount>=SCAN_POINTS)) return(false);
+  if(scanPass==SCAN_COARSE_PASS)
+  {
+    // Coarse pass, measuring every SCAN_COARSE-th frequency
+    if(scanIdx < scanCount) return(true);
 
-  // Wait for the right time
-  if(millis() - scanTime < SCAN_TIME) return(true);
+    // Always measure the band edge
+    if(!SCAN_RSSI(scanData[scanCount - 1]))
+    {
+      scanIdx = scanCount - 1;
+      return(true);
+    }
 
-  // This is our current frequency to scan
-  uint16_t freq = scanStartFreq + scanStep * scanCount;
+    // Start refining
+    scanPass = SCAN_REFINE_PASS;
+    scanIdx  = 0;
+  }
 
-  // If frequency not yet set, set it and wait until next call to measure
-  if(rx.getFrequency() != freq)
+  // Refine pass, measuring frequencies next to possible carriers
+  for( ; scanIdx < scanCount ; scanIdx++)
   {
-    rx.setFrequency(freq);
-    scanTime = millis();
-    return(true);
+    if(SCAN_RSSI(scanData[scanIdx])) continue;
+
+    int coarse = scanIdx / SCAN_COARSE * SCAN_COARSE;
+    if(scanIsPeak(coarse) || scanIsPeak(coarse + SCAN_COARSE)) return(true);
+    if(coarse + SCAN_COARSE >= scanCount && scanIsPeak(scanCount - 1)) return(true);
   }
 
-  // Measure RSSI/SNR values
+  return(false);
+}
+
+static void scanMeasure(bool again)
+{
+  // Measure RSSI/SNR values, quantizing them to fit a byte
   rx.getCurrentReceivedSignalQuality();
-  scanData[scanCount].rssi = rx.getCurrentRSSI();
-  scanData[scanCount].snr  = rx.getCurrentSNR();
+  uint8_t rssi = min(15, 1 + rx.getCurrentRSSI() / 4);
+  uint8_t snr  = min(15, rx.getCurrentSNR() / 2);
 
-  // Measure range of values
-  scanMinRSSI = min(scanData[scanCount].rssi, scanMinRSSI);
-  scanMaxRSSI = max(scanData[scanCount].rssi, scanMaxRSSI);
-  scanMinSNR  = min(scanData[scanCount].snr, scanMinSNR);
-  scanMaxSNR  = max(scanData[scanCount].snr, scanMaxSNR);
+  // Keep the best values if measuring again
+  if(again)
+  {
+    rssi = max(SCAN_RSSI(scanData[scanIdx]), rssi);
+    snr  = max(SCAN_SNR(scanData[scanIdx]), snr);
+  }
+
+  scanData[scanIdx] = (rssi << 4) | snr;
+  scanVersion++;
+
+  // Measure range of values, so that the data can be shown right away
+  scanMinRSSI = min(rssi, scanMinRSSI);
+  scanMaxRSSI = max(rssi, scanMaxRSSI);
+  scanMinSNR  = min(snr, scanMinSNR);
+  scanMaxSNR  = max(snr, scanMaxSNR);
+}
+
+static bool scanProcess()
+{
+  // Scan must be on
+  if((scanStatus!=SCAN_RUN) || (scanIdx>=scanCount)) return(false);
+
+  switch(scanPhase)
+  {
+    case SCAN_TUNE:
+      // Set frequency and wait until tuning completes
+      rx.setFrequency(scanStartFreq + scanStep * scanIdx);
+      scanTime  = millis();
+      scanPhase = SCAN_SETTLE;
+      return(true);
+
+    case SCAN_SETTLE:
+      // Wait for the tuning to complete, but not too long
+      rx.getStatus(1, 0);
+      if(!rx.getTuneCompleteTriggered())
+      {
+        if(millis() - scanTime < SCAN_TIME) return(true);
+        scanStats.timeouts++;
+      }
+
+      scanMeasure(false);
+
+      // Something that may be a carrier, give AGC time and measure again
+      if(SCAN_SNR(scanData[scanIdx]) >= SCAN_CARRIER)
+      {
+        scanStats.dwells++;
+        scanTime  = millis();
+        scanPhase = SCAN_MEASURE;
+        return(true);
+      }
+      break;
+
+    case SCAN_MEASURE:
+      // Wait for the right time
+      if(millis() - scanTime < SCAN_DWELL) return(true);
+      scanMeasure(true);
+      break;
+  }
+
+  scanStats.bins++;
 
   // Next frequency to scan
-  freq += scanStep;
+  scanIdx += scanPass==SCAN_COARSE_PASS? SCAN_COARSE : 1;
 
   // Set next frequency to scan or expire scan
-  if((++scanCount >= SCAN_POINTS) || !isFreqInBand(getCurrentBand(), freq))
+  if(!scanFindNext())
     scanStatus = SCAN_DONE;
   else
-    rx.setFrequency(freq);
-
-  // Save last scan time
-  scanTime = millis();
+  {
+    rx.setFrequency(scanStartFreq + scanStep * scanIdx);
+    scanTime  = millis();
+    scanPhase = SCAN_SETTLE;
+  }
 
   // Return current scan status
   return(scanStatus==SCAN_RUN);
 }
 
+static void scanRestore()
+{
+  // Account for the time spent scanning
+  scanStats.time += micros() - scanStartTime;
+  scanStats.sweeps++;
+
+  // Restore current frequency
+  rx.setMaxDelaySetFrequency(MAX_DELAY_AFTER_SET_FREQUENCY);
+  rx.setFrequency(scanSavedFreq);
+
+  // Radio task sleeps while scanning
+  radioWake();
+}
+
 //
-// Run entire scan once
+// Stop scan, keeping data collected so far
 //
-void scanRun(uint16_t centerFreq, uint16_t step)
+void scanStop()
 {
-  // Save current frequency
-  uint16_t curFreq = rx.getFrequency();
-  // Scan the whole range
-  for(scanInit(centerFreq, step) ; scanTickTime() ; delay(SCAN_TIME));
-  // Restore current frequency
-  rx.setFrequency(curFreq);
+  if(scanStatus!=SCAN_RUN) return;
+  scanStatus = SCAN_DONE;
+  scanRestore();
+}
+
+//
+// Stop scan and drop its data and zoom, i.e. when changing bands
+//
+void scanClear()
+{
+  scanStop();
+  scanStatus  = SCAN_OFF;
+  scanZoomIdx = 0;
+  scanVersion++;
+}
+
+bool scanIsRunning()
+{
+  return(scanStatus==SCAN_RUN);
+}
+
+//
+// Start scanning the whole current band in background, it runs from
+// scanTickTime(). The step is increased if the band does not fit.
+//
+void scanStart(uint16_t step)
+{
+  // Stop previous scan, if any
+  scanStop();
+
+  // Finish pending tuning, save current frequency
+  radioSync();
+  scanSavedFreq = rx.getFrequency();
+  // Do not wait after tuning, poll for the tuning to complete instead
+  rx.setMaxDelaySetFrequency(0);
+
+  scanInit(step);
+  scanDrawTime = millis();
+}
+
+//
+// Called from the main loop to scan next frequency, returns TRUE
+// when the screen has to be updated with new scan data
+//
+bool scanTickTime()
+{
+  uint16_t idx = scanIdx;
+
+  if(scanStatus!=SCAN_RUN) return(false);
+
+  // Finished scanning, restore current frequency
+  if(!scanProcess())
+  {
+    scanRestore();
+    return(true);
+  }
+
+  // Periodically show new data
+  if(scanIdx!=idx && (millis() - scanDrawTime >= SCAN_REDRAW))
+  {
+    scanDrawTime = millis();
+    return(true);
+  }
+
+  return(false);
 }
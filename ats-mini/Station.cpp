@@ -228,8 +228,7 @@ bool checkRds()
   bool needRedraw = false;
   uint8_t mode = getRDSMode();
 
-  rx.getRdsStatus();
-
+  // RDS status has been read by the radio task
   if(rx.getRdsReceived() && rx.getRdsSync() && rx.getRdsSyncFound())
   {
     needRedraw |= (mode & RDS_PS) && showStationName(rx.getRdsStationName());
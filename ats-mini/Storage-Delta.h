@@ -0,0 +1,29 @@
+#ifndef STORAGE_DELTA_H
+#define STORAGE_DELTA_H
+
+#include <stdint.h>
+
+// Write a byte to the storage being updated
+typedef void (*StorageWrite)(int addr, uint8_t data);
+
+//
+// Write bytes of BUF that differ from IMAGE (the last committed
+// contents) with WRITE, then update IMAGE. Returns the number of bytes
+// written, 0 meaning that nothing needs to be committed.
+//
+static inline int storageUpdate(const uint8_t *buf, uint8_t *image, int size, StorageWrite write)
+{
+  int result = 0;
+
+  for(int j=0 ; j<size ; ++j)
+    if(buf[j]!=image[j])
+    {
+      write(j, buf[j]);
+      image[j] = buf[j];
+      result++;
+    }
+
+  return(result);
+}
+
+#endif // STORAGE_DELTA_H
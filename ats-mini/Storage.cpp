@@ -1,6 +1,7 @@
 #include "EEPROM.h"
 #include "Common.h"
 #include "Storage.h"
+#include "Storage-Delta.h"
 #include "Themes.h"
 #include "Menu.h"
 #include <LittleFS.h>
@@ -21,6 +22,63 @@ static uint32_t storeTime    = millis();
 // Buffer used to stage EEPROM updates
 static uint8_t updateBuf[EEPROM_SIZE];
 
+// Buffer used to stage saved configuration
+static uint8_t saveBuf[EEPROM_SIZE];
+
+// Last committed EEPROM contents, used to skip writing unchanged data
+static uint8_t eepromImage[EEPROM_SIZE];
+static bool eepromImageValid = false;
+
+static EepromStats eepromStats = { 0 };
+
+//
+// Return EEPROM write statistics, optionally starting over
+//
+EepromStats eepromGetStats(bool reset)
+{
+  EepromStats result = eepromStats;
+  if(reset) eepromStats = (EepromStats){ 0 };
+  return(result);
+}
+
+//
+// Read EEPROM contents into eepromImage, unless already there
+//
+static void eepromLoadImage()
+{
+  if(eepromImageValid) return;
+
+  EEPROM.begin(EEPROM_SIZE);
+  for(int j=0 ; j<EEPROM_SIZE ; ++j)
+    eepromImage[j] = EEPROM.read(j);
+  EEPROM.end();
+
+  eepromImageValid = true;
+}
+
+static void eepromWriteByte(int addr, uint8_t data)
+{
+  EEPROM.write(addr, data);
+}
+
+//
+// Write BUF into EEPROM, with a single commit of the changed bytes.
+// Returns TRUE if anything has been written.
+//
+static bool eepromCommit(const uint8_t *buf)
+{
+  eepromStats.saves++;
+  eepromLoadImage();
+  if(!memcmp(buf, eepromImage, sizeof(eepromImage))) return(false);
+
+  EEPROM.begin(EEPROM_SIZE);
+  eepromStats.bytes += storageUpdate(buf, eepromImage, EEPROM_SIZE, eepromWriteByte);
+  EEPROM.commit();
+  EEPROM.end();
+  eepromStats.commits++;
+  return(true);
+}
+
 // To store any change into the EEPROM, we need at least STORE_TIME
 // milliseconds of inactivity.
 void eepromRequestSave(bool now)
@@ -83,6 +141,10 @@ void eepromInvalidate()
   EEPROM.write(EEPROM_VER_ADDR + 2, 0x01);
   EEPROM.commit();
   EEPROM.end();
+  eepromStats.commits++;
+
+  // EEPROM contents changed behind eepromImage
+  eepromImageValid = false;
 }
 
 // Return true first time after the settings have been reset
@@ -93,6 +155,9 @@ bool eepromFirstRun()
   if(firstRun) EEPROM.write(EEPROM_VER_ADDR + 2, 0x00);
   EEPROM.end();
 
+  // EEPROM contents changed behind eepromImage
+  eepromImageValid = false;
+
   return(firstRun);
 }
 
@@ -120,27 +185,27 @@ bool eepromVerify(const uint8_t *buf)
   return(appId==EEPROM_VERSION);
 }
 
-// Store current receiver configuration into the EEPROM.
-// @@@ FIXME: Use EEPROM.update() to avoid writing the same
-//            data in the same memory position. It will save
-//            unnecessary recording.
+// Store current receiver configuration into the EEPROM. The new
+// contents are staged in memory and only written if changed.
 void eepromSaveConfig()
 {
   // G8PTN: For SSB ensures BFO value is valid with respect to
   // bands[bandIdx].currentFreq = currentFrequency
   int16_t currentBFOs = currentBFO % 1000;
   int addr = EEPROM_BASE_ADDR;
+  uint8_t *buf = saveBuf;
 
-  EEPROM.begin(EEPROM_SIZE);
+  // Start with the current contents, for the bytes not saved here
+  eepromLoadImage();
+  memcpy(buf, eepromImage, sizeof(saveBuf));
 
-  EEPROM.write(addr++, EEPROM_VERSION);     // Stores the EEPROM_VERSION;
-  EEPROM.write(addr++, volume);             // Stores the current Volume
-  EEPROM.write(addr++, bandIdx);            // Stores the current band
-  EEPROM.write(addr++, wifiModeIdx);        // Stores WiFi connection mode
-  EEPROM.write(addr++, currentMode);        // Stores the current mode (FM / AM / LSB / USB). Now per mode, leave for compatibility
-  EEPROM.write(addr++, currentBFOs >> 8);   // G8PTN: Stores the current BFO % 1000 (HIGH byte)
-  EEPROM.write(addr++, currentBFOs & 0XFF); // G8PTN: Stores the current BFO % 1000 (LOW byte)
-  EEPROM.commit();
+  buf[addr++] = EEPROM_VERSION;      // Stores the EEPROM_VERSION;
+  buf[addr++] = volume;              // Stores the current Volume
+  buf[addr++] = bandIdx;             // Stores the current band
+  buf[addr++] = wifiModeIdx;         // Stores WiFi connection mode
+  buf[addr++] = currentMode;         // Stores the current mode (FM / AM / LSB / USB). Now per mode, leave for compatibility
+  buf[addr++] = currentBFOs >> 8;    // G8PTN: Stores the current BFO % 1000 (HIGH byte)
+  buf[addr++] = currentBFOs & 0XFF;  // G8PTN: Stores the current BFO % 1000 (LOW byte)
 
   // G8PTN: Commented out the assignment
   // - The line appears to be required to ensure the bands[bandIdx].currentFreq = currentFrequency
@@ -152,67 +217,60 @@ void eepromSaveConfig()
   // Store current band settings
   for(int i=0 ; i<getTotalBands() ; i++)
   {
-    EEPROM.write(addr++, bands[i].currentFreq >> 8);   // Stores the current Frequency HIGH byte for the band
-    EEPROM.write(addr++, bands[i].currentFreq & 0xFF); // Stores the current Frequency LOW byte for the band
-    EEPROM.write(addr++, bands[i].currentStepIdx);     // Stores current step of the band
-    EEPROM.write(addr++, bands[i].bandwidthIdx);       // Stores bandwidth index
-    EEPROM.commit();
+    buf[addr++] = bands[i].currentFreq >> 8;    // Stores the current Frequency HIGH byte for the band
+    buf[addr++] = bands[i].currentFreq & 0xFF;  // Stores the current Frequency LOW byte for the band
+    buf[addr++] = bands[i].currentStepIdx;      // Stores current step of the band
+    buf[addr++] = bands[i].bandwidthIdx;        // Stores bandwidth index
   }
 
   // Store current memories
   addr = EEPROM_SETM_ADDR;
   for(int i=0 ; i<getTotalMemories() ; i++)
   {
-    EEPROM.write(addr++, memories[i].freq >> 8);       // Stores frequency HIGH byte
-    EEPROM.write(addr++, memories[i].freq & 0xFF);     // Stores frequency LOW byte
-    EEPROM.write(addr++, memories[i].mode);            // Stores modulation
-    EEPROM.write(addr++, memories[i].band);            // Stores band index
-    EEPROM.commit();
+    buf[addr++] = memories[i].freq >> 8;        // Stores frequency HIGH byte
+    buf[addr++] = memories[i].freq & 0xFF;      // Stores frequency LOW byte
+    buf[addr++] = memories[i].mode;             // Stores modulation
+    buf[addr++] = memories[i].band;             // Stores band index
   }
 
   // G8PTN: Added
   addr = EEPROM_SET_ADDR;
-  EEPROM.write(addr++, currentBrt >> 8);         // Stores the current Brightness value (HIGH byte)
-  EEPROM.write(addr++, currentBrt & 0XFF);       // Stores the current Brightness value (LOW byte)
-  EEPROM.write(addr++, FmAgcIdx);                // Stores the current FM AGC/ATTN index value
-  EEPROM.write(addr++, AmAgcIdx);                // Stores the current AM AGC/ATTN index value
-  EEPROM.write(addr++, SsbAgcIdx);               // Stores the current SSB AGC/ATTN index value
-  EEPROM.write(addr++, AmAvcIdx);                // Stores the current AM AVC index value
-  EEPROM.write(addr++, SsbAvcIdx);               // Stores the current SSB AVC index value
-  EEPROM.write(addr++, AmSoftMuteIdx);           // Stores the current AM SoftMute index value
-  EEPROM.write(addr++, SsbSoftMuteIdx);          // Stores the current SSB SoftMute index value
-  EEPROM.write(addr++, currentSleep >> 8);       // Stores the current Sleep value (HIGH byte)
-  EEPROM.write(addr++, currentSleep & 0XFF);     // Stores the current Sleep value (LOW byte)
-  EEPROM.write(addr++, themeIdx);                // Stores the current Theme index value
-  EEPROM.write(addr++, rdsModeIdx);              // Stores the current RDS Mode value
-  EEPROM.write(addr++, sleepModeIdx);            // Stores the current Sleep Mode value
-  EEPROM.write(addr++, (uint8_t)zoomMenu);       // Stores the current Zoom Menu setting
-  EEPROM.write(addr++, scrollDirection<0? 1:0);  // Stores the current Scroll setting
-  EEPROM.write(addr++, utcOffsetIdx);            // Stores the current UTC Offset
-  EEPROM.write(addr++, currentSquelch);          // Stores the current Squelch value
-  EEPROM.write(addr++, FmRegionIdx);             // Stores the current FM region value
-  EEPROM.write(addr++, uiLayoutIdx);             // Stores the current UI Layout index value
-  EEPROM.write(addr++, bleModeIdx);              // Stores the current Bluetooth mode index value
-  EEPROM.commit();
+  buf[addr++] = currentBrt >> 8;          // Stores the current Brightness value (HIGH byte)
+  buf[addr++] = currentBrt & 0XFF;        // Stores the current Brightness value (LOW byte)
+  buf[addr++] = FmAgcIdx;                 // Stores the current FM AGC/ATTN index value
+  buf[addr++] = AmAgcIdx;                 // Stores the current AM AGC/ATTN index value
+  buf[addr++] = SsbAgcIdx;                // Stores the current SSB AGC/ATTN index value
+  buf[addr++] = AmAvcIdx;                 // Stores the current AM AVC index value
+  buf[addr++] = SsbAvcIdx;                // Stores the current SSB AVC index value
+  buf[addr++] = AmSoftMuteIdx;            // Stores the current AM SoftMute index value
+  buf[addr++] = SsbSoftMuteIdx;           // Stores the current SSB SoftMute index value
+  buf[addr++] = currentSleep >> 8;        // Stores the current Sleep value (HIGH byte)
+  buf[addr++] = currentSleep & 0XFF;      // Stores the current Sleep value (LOW byte)
+  buf[addr++] = themeIdx;                 // Stores the current Theme index value
+  buf[addr++] = rdsModeIdx;               // Stores the current RDS Mode value
+  buf[addr++] = sleepModeIdx;             // Stores the current Sleep Mode value
+  buf[addr++] = (uint8_t)zoomMenu;        // Stores the current Zoom Menu setting
+  buf[addr++] = scrollDirection<0? 1:0;   // Stores the current Scroll setting
+  buf[addr++] = utcOffsetIdx;             // Stores the current UTC Offset
+  buf[addr++] = currentSquelch;           // Stores the current Squelch value
+  buf[addr++] = FmRegionIdx;              // Stores the current FM region value
+  buf[addr++] = uiLayoutIdx;              // Stores the current UI Layout index value
+  buf[addr++] = bleModeIdx;               // Stores the current Bluetooth mode index value
 
   addr = EEPROM_SETP_ADDR;
   for(int i=0 ; i<getTotalBands() ; i++)
   {
-    EEPROM.write(addr++, bands[i].bandCal >> 8);   // Stores the current Calibration value (HIGH byte) for the band
-    EEPROM.write(addr++, bands[i].bandCal & 0XFF); // Stores the current Calibration value (LOW byte) for the band
-    EEPROM.write(addr++, bands[i].bandMode);       // Stores the current Mode value for the band
-    EEPROM.commit();
+    buf[addr++] = bands[i].bandCal >> 8;    // Stores the current Calibration value (HIGH byte) for the band
+    buf[addr++] = bands[i].bandCal & 0XFF;  // Stores the current Calibration value (LOW byte) for the band
+    buf[addr++] = bands[i].bandMode;        // Stores the current Mode value for the band
   }
 
   addr = EEPROM_VER_ADDR;
-  EEPROM.write(addr++, APP_VERSION >> 8);        // Stores APP_VERSION (HIGH byte)
-  EEPROM.write(addr++, APP_VERSION & 0XFF);      // Stores APP_VERSION (LOW byte)
-  EEPROM.commit();
-
-  EEPROM.end();
+  buf[addr++] = APP_VERSION >> 8;         // Stores APP_VERSION (HIGH byte)
+  buf[addr++] = APP_VERSION & 0XFF;       // Stores APP_VERSION (LOW byte)
 
   // Data has been written into EEPROM
-  showEepromFlag = true;
+  showEepromFlag |= eepromCommit(buf);
 }
 
 void eepromLoadConfig()
@@ -341,12 +399,6 @@ bool eepromWriteBinary(const uint8_t *buf, uint32_t size)
   // Make sure nobody saves
   itIsTimeToSave = false;
 
-  EEPROM.begin(EEPROM_SIZE);
-
-  for(int j=0 ; j<EEPROM_SIZE ; ++j)
-    EEPROM.write(j, buf[j]);
-
-  EEPROM.end();
-
+  eepromCommit(buf);
   return(true);
 }
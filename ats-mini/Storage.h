@@ -3,6 +3,15 @@
 
 #define EEPROM_SIZE 512
 
+typedef struct
+{
+  uint32_t saves;         // Requests to write EEPROM contents
+  uint32_t commits;       // EEPROM commits
+  uint32_t bytes;         // Bytes changed by commits
+} EepromStats;
+
+EepromStats eepromGetStats(bool reset = false);
+
 bool eepromFirstRun();
 void eepromTickTime();
 void eepromInvalidate();
@@ -4,6 +4,7 @@
 #include "Button.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "EIBI.h"
 
 // SSB patch for whole SSBRX initialization string
 #include "patch_init.h"
@@ -141,6 +142,11 @@ void tempMuteOn(bool x)
 }
 
 
+static void drawBlank(uint8_t arg)
+{
+  spr.fillSprite(TFT_BLACK);
+}
+
 //
 // Turn sleep on (1) or off (0), or get current status (2)
 //
@@ -150,10 +156,9 @@ bool sleepOn(int x)
   {
     sleep_on = true;
     ledcWrite(PIN_LCD_BL, 0);
-    spr.fillSprite(TFT_BLACK);
-    spr.pushSprite(0, 0);
-    tft.writecommand(ST7789_DISPOFF);
-    tft.writecommand(ST7789_SLPIN);
+    drawFrame(drawBlank, 0);
+    drawCommand(ST7789_DISPOFF);
+    drawCommand(ST7789_SLPIN);
 
     // Wait till the button is released to prevent immediate wakeup
     while(pb1.update(digitalRead(ENCODER_PUSH_BUTTON) == LOW).isPressed)
@@ -205,9 +210,9 @@ bool sleepOn(int x)
   else if((x==0) && sleep_on)
   {
     sleep_on = false;
-    tft.writecommand(ST7789_SLPOUT);
+    drawCommand(ST7789_SLPOUT);
     delay(120);
-    tft.writecommand(ST7789_DISPON);
+    drawCommand(ST7789_DISPON);
     drawScreen();
     ledcWrite(PIN_LCD_BL, currentBrt);
     // Wait till the button is released to prevent the main loop clicks
@@ -312,6 +317,8 @@ bool clockTickTime()
 
       // Format clock for display and ask for screen update
       clockRefreshTime();
+      // Update stations on the air now
+      eibiSetTime(clockHours, clockMinutes);
       return(true);
     }
   }
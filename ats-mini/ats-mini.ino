@@ -15,13 +15,13 @@
 #include "EIBI.h"
 
 // SI473/5 and UI
-#define MIN_ELAPSED_TIME         5  // 300
+#define MIN_ELAPSED_TIME         5  // Main loop sleep while busy
+#define MAX_ELAPSED_TIME        50  // Main loop sleep while idle, unless woken up
 #define MIN_ELAPSED_RSSI_TIME  200  // RSSI check uses IN_ELAPSED_RSSI_TIME * 6 = 1.2s
 #define ELAPSED_COMMAND      10000  // time to turn off the last command controlled by encoder. Time to goes back to the VFO control // G8PTN: Increased time and corrected comment
 #define DEFAULT_VOLUME          35  // change it for your favorite sound volume
 #define DEFAULT_SLEEP            0  // Default sleep interval, range = 0 (off) to 255 in steps of 5
 #define STRENGTH_CHECK_TIME   1500  // Not used
-#define RDS_CHECK_TIME         250  // Increased from 90
 #define SEEK_TIMEOUT        600000  // Max seek timeout (ms)
 #define NTP_CHECK_TIME       60000  // NTP time refresh period (ms)
 #define SCHEDULE_CHECK_TIME   2000  // How often to identify the same frequency (ms)
@@ -40,16 +40,17 @@ int8_t softMuteMaxAttIdx = 4;
 bool seekStop = false;        // G8PTN: Added flag to abort seeking on rotary encoder detection
 bool pushAndRotate = false;   // Push and rotate is active, ignore the long press
 
-long elapsedRSSI = millis();
 long elapsedButton = millis();
 
 long lastStrengthCheck = millis();
-long lastRDSCheck = millis();
-long lastNTPCheck = millis();
-long lastScheduleCheck = millis();
+
+// Periodic jobs run from the main loop
+Job rssiJob     = { MIN_ELAPSED_RSSI_TIME, millis() };
+Job ntpJob      = { NTP_CHECK_TIME, millis() };
+Job scheduleJob = { SCHEDULE_CHECK_TIME, millis() };
 
 long elapsedCommand = millis();
-volatile int encoderCount = 0;
+int encoderCount = 0;
 uint16_t currentFrequency;
 
 // AGC/ATTN index per mode (FM/AM/SSB)
@@ -106,8 +107,14 @@ SI4735_fixed rx;
 //
 void setup()
 {
+  // Main loop sleeps until woken up by events
+  eventInit();
+
   // Enable serial port
   Serial.begin(115200);
+#if !defined(DISABLE_REMOTE) && ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+  Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, remoteRxEvent);
+#endif
 
   // Initialize flash file system
   diskInit();
@@ -148,7 +155,16 @@ void setup()
   }
 
   tft.fillScreen(TH.bg);
+#ifdef ENABLE_8BIT
+  // Half the memory, colors expanded when pushing to the display
+  spr.setColorDepth(8);
+#endif
+#ifdef ENABLE_STRIPS
+  // Only one strip of the screen is kept in memory
+  spr.createSprite(320, STRIP_H);
+#else
   spr.createSprite(320, 170);
+#endif
   spr.setTextDatum(MC_DATUM);
   spr.setSwapBytes(true);
   spr.setFreeFont(&Orbitron_Light_24);
@@ -224,10 +240,8 @@ void setup()
   // Show help screen on first run
   if(eepromFirstRun())
   {
-    // Clear screen buffer
-    spr.fillSprite(TH.bg);
     ledcWrite(PIN_LCD_BL, currentBrt);
-    drawAboutHelp(0);
+    drawFrame(drawAboutHelp, 0);
     while(digitalRead(ENCODER_PUSH_BUTTON) != LOW) delay(100);
     while(digitalRead(ENCODER_PUSH_BUTTON) == LOW) delay(100);
   }
@@ -241,6 +255,10 @@ void setup()
   // ICACHE_RAM_ATTR void rotaryEncoder(); see rotaryEncoder implementation below.
   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_A), rotaryEncoder, CHANGE);
   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_B), rotaryEncoder, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_PUSH_BUTTON), eventSignalFromISR, CHANGE);
+
+  // Poll receiver and tune in background from now on
+  radioInit();
 
   // Connect WiFi, if necessary
   netInit(wifiModeIdx);
@@ -262,16 +280,30 @@ ICACHE_RAM_ATTR void rotaryEncoder()
   uint8_t encoderStatus = encoder.process();
   if(encoderStatus)
   {
-    encoderCount = encoderStatus==DIR_CW? 1 : -1;
+    encoderPush(encoderStatus==DIR_CW? 1 : -1);
     seekStop = true;
+    eventSignalFromISR();
   }
 }
 
+#if !defined(DISABLE_REMOTE) && ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+//
+// Wake up the main loop on serial input
+//
+static void remoteRxEvent(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+  eventSignal();
+}
+#endif
+
 //
 // Switch radio to given band
 //
 void useBand(const Band *band)
 {
+  // Finish pending tuning before switching modes
+  radioSync();
+
   // Set current frequency and mode, reset BFO
   currentFrequency = band->currentFreq;
   currentMode = band->bandMode;
@@ -409,13 +441,15 @@ bool updateBFO(int newBFO, bool wrap)
   // If need to change frequency...
   if(newFreq != currentFrequency)
   {
-    // Apply new frequency
+    // Apply new frequency, right away, once for any number of steps
+    scanStop();
+    radioSync();
     rx.setFrequency(newFreq);
 
     // Re-apply to remove noise
     doAgc(0);
-    // Update current frequency
-    currentFrequency = rx.getFrequency();
+    // Update current frequency, SSB tuning is exact
+    currentFrequency = newFreq;
   }
 
   // Update current BFO
@@ -446,14 +480,17 @@ bool updateFrequency(int newFreq, bool wrap)
     if(!wrap) return false; else newFreq = band->minimumFreq;
   }
 
-  // Set new frequency
-  rx.setFrequency(newFreq);
+  // Band scan would restore the old frequency when stopped later
+  scanStop();
+
+  // Set new frequency, the radio task tunes in background
+  radioTune(newFreq);
 
   // Clear BFO, if present
   if(currentBFO) updateBFO(0, true);
 
   // Update current frequency
-  currentFrequency = rx.getFrequency();
+  currentFrequency = newFreq;
 
   // Save current band frequency
   band->currentFreq = currentFrequency + currentBFO / 1000;
@@ -464,7 +501,7 @@ bool updateFrequency(int newFreq, bool wrap)
 //
 // Handle encoder rotation in seek mode
 //
-bool doSeek(int8_t dir)
+bool doSeek(int dir)
 {
   if(seekMode() == SEEK_DEFAULT)
   {
@@ -486,6 +523,7 @@ bool doSeek(int8_t dir)
 
       // G8PTN: Flag is set by rotary encoder and cleared on seek entry
       seekStop = false;
+      radioSync();
       rx.seekStationProgress(showFrequencySeek, checkStopSeeking, dir>0? 1 : 0);
       updateFrequency(rx.getFrequency(), true);
     }
@@ -496,12 +534,11 @@ bool doSeek(int8_t dir)
     // Clock is valid because the above seekMode() call checks that
     clockGetHM(&hour, &minute);
 
-    size_t offset = -1;
-    const StationSchedule *schedule = dir > 0 ?
-      eibiNext(currentFrequency + currentBFO / 1000, hour, minute, &offset) :
-      eibiPrev(currentFrequency + currentBFO / 1000, hour, minute, &offset);
+    uint16_t freq = dir > 0 ?
+      eibiNextFreq(currentFrequency + currentBFO / 1000, hour, minute) :
+      eibiPrevFreq(currentFrequency + currentBFO / 1000, hour, minute);
 
-    if(schedule) updateFrequency(schedule->freq, false);
+    if(freq) updateFrequency(freq, false);
   }
 
   // Clear current station name and information
@@ -513,9 +550,9 @@ bool doSeek(int8_t dir)
 }
 
 //
-// Handle tuning
+// Handle tuning by DIR steps, with a single tuning request
 //
-bool doTune(int8_t dir)
+bool doTune(int dir)
 {
   //
   // SSB tuning
@@ -528,11 +565,12 @@ bool doTune(int8_t dir)
     tuning_timer = millis();
 #endif
 
-    uint32_t step = getCurrentStep()->step;
-    uint32_t stepAdjust = (currentFrequency * 1000 + currentBFO) % step;
-    step = !stepAdjust? step : dir>0? step - stepAdjust : stepAdjust;
+    int step = getCurrentStep()->step;
+    int first = (currentFrequency * 1000 + currentBFO) % step;
+    first = !first? step : dir>0? step - first : first;
 
-    updateBFO(currentBFO + dir * step, true);
+    // First step aligns to the step grid, the rest are full steps
+    updateBFO(currentBFO + (dir>0? first + (dir - 1) * step : (dir + 1) * step - first), true);
   }
 
   //
@@ -546,13 +584,13 @@ bool doTune(int8_t dir)
     tuning_timer = millis();
 #endif
 
-    uint16_t step = getCurrentStep()->step;
-    uint16_t stepAdjust = currentFrequency % step;
-    stepAdjust = (currentMode==FM) && (step==20)? (stepAdjust+10) % step : stepAdjust;
-    step = !stepAdjust? step : dir>0? step - stepAdjust : stepAdjust;
+    int step = getCurrentStep()->step;
+    int first = currentFrequency % step;
+    first = (currentMode==FM) && (step==20)? (first+10) % step : first;
+    first = !first? step : dir>0? step - first : first;
 
-    // Tune to a new frequency
-    updateFrequency(currentFrequency + step * dir, true);
+    // Tune to a new frequency, first step aligns to the step grid
+    updateFrequency(currentFrequency + (dir>0? first + (dir - 1) * step : (dir + 1) * step - first), true);
   }
 
   // Clear current station name and information
@@ -564,37 +602,28 @@ bool doTune(int8_t dir)
 }
 
 //
-// Rotate digit
+// Rotate digit by DIR steps, going as far as the band allows
 //
-bool doDigit(int8_t dir)
+bool doDigit(int dir)
 {
   bool updated = false;
 
-  // SSB tuning
-  if(isSSB())
-  {
 #ifdef ENABLE_HOLDOFF
-    // Tuning timer to hold off (SSB) display updates
-    tuning_flag = true;
-    tuning_timer = millis();
+  // Tuning timer to hold off display updates
+  tuning_flag = true;
+  tuning_timer = millis();
 #endif
 
-    updated = updateBFO(currentBFO + dir * getFreqInputStep(), false);
-  }
-
-  //
-  // Normal tuning
-  //
-  else
+  // Nothing is tuned unless the target is within the band, so
+  // trying fewer steps costs nothing
+  for(; dir && !updated ; dir += dir>0? -1 : 1)
   {
-#ifdef ENABLE_HOLDOFF
-    // Tuning timer to hold off (FM/AM) display updates
-    tuning_flag = true;
-    tuning_timer = millis();
-#endif
-
-    // Tune to a new frequency
-    updated = updateFrequency(currentFrequency + getFreqInputStep() * dir, false);
+    // SSB tuning
+    if(isSSB())
+      updated = updateBFO(currentBFO + dir * getFreqInputStep(), false);
+    // Normal tuning
+    else
+      updated = updateFrequency(currentFrequency + getFreqInputStep() * dir, false);
   }
 
   if (updated) {
@@ -638,9 +667,13 @@ bool processRssiSnr()
   static uint32_t updateCounter = 0;
   bool needRedraw = false;
 
-  rx.getCurrentReceivedSignalQuality();
-  int newRSSI = rx.getCurrentRSSI();
-  int newSNR = rx.getCurrentSNR();
+  // Latest signal quality, as read by the radio task, unless it
+  // has been measured at the previous frequency
+  RadioStatus status = radioGetStatus();
+  int newRSSI = status.rssi;
+  int newSNR = status.snr;
+
+  if(status.stale) return(false);
 
   // Apply squelch if the volume is not muted
   if(currentSquelch && currentSquelch <= 127)
@@ -689,8 +722,15 @@ void loop()
   uint32_t currentTime = millis();
   bool needRedraw = false;
 
+  // Talk to the receiver exclusively, until drawing the screen
+  radioLock();
+
   ButtonTracker::State pb1st = pb1.update(digitalRead(ENCODER_PUSH_BUTTON) == LOW);
 
+  // Collect encoder rotation since the last iteration, accelerated
+  // unless selecting digits or seeking
+  encoderCount = encoderDrain(!pushAndRotate && !pb1st.isPressed && currentCmd!=CMD_SEEK);
+
 #ifndef DISABLE_REMOTE
   // Periodically print status to serial
   remoteTickTime();
@@ -702,7 +742,10 @@ void loop()
     needRedraw |= !!(revent & REMOTE_CHANGED);
     pb1st.wasClicked |= !!(revent & REMOTE_CLICK);
     int direction = revent >> REMOTE_DIRECTION;
-    encoderCount = direction? direction : encoderCount;
+    // Merge queued rotations into a single multi-step one
+    while(direction && (Serial.peek()=='R' || Serial.peek()=='r'))
+      direction += remoteDoCommand(Serial.read()) >> REMOTE_DIRECTION;
+    encoderCount += direction;
     if(revent & REMOTE_EEPROM) eepromRequestSave();
   }
 #endif
@@ -712,6 +755,13 @@ void loop()
   // Block encoder rotation when in the locked sleep mode
   if(encoderCount && sleepOn() && sleepModeIdx==SLEEP_LOCKED) encoderCount = 0;
 
+  // Any encoder action outside of the scan menu stops band scan
+  if((encoderCount || pb1st.isPressed) && scanIsRunning() && currentCmd!=CMD_SCAN)
+  {
+    scanStop();
+    needRedraw = true;
+  }
+
   // Activate push and rotate mode (can span multiple loop iterations until the button is released)
   if (encoderCount && pb1st.isPressed) pushAndRotate = true;
 
@@ -871,32 +921,26 @@ void loop()
     elapsedSleep = elapsedCommand = currentTime = millis();
   }
 
-  if((currentTime - elapsedRSSI) > MIN_ELAPSED_RSSI_TIME)
-  {
+  if(jobDue(&rssiJob, currentTime))
     needRedraw |= processRssiSnr();
-    elapsedRSSI = currentTime;
-  }
 
-  // Periodically check received RDS information
-  if((currentTime - lastRDSCheck) > RDS_CHECK_TIME)
-  {
-    needRedraw |= (currentMode == FM) && (snr >= 12) && checkRds();
-    lastRDSCheck = currentTime;
-  }
+  // Process RDS information received by the radio task
+  if(radioRdsReady())
+    needRedraw |= (currentMode == FM) && checkRds();
 
   // Periodically check schedule
-  if((currentTime - lastScheduleCheck) > SCHEDULE_CHECK_TIME)
-  {
+  if(jobDue(&scheduleJob, currentTime))
     needRedraw |= identifyFrequency(currentFrequency + currentBFO / 1000, true);
-    lastScheduleCheck = currentTime;
-  }
+
+  // Scan next frequency, showing partial results
+  needRedraw |= scanTickTime();
+
+  // Install loaded schedule and show loading progress
+  needRedraw |= eibiTickTime();
 
   // Periodically synchronize time via NTP
-  if((currentTime - lastNTPCheck) > NTP_CHECK_TIME)
-  {
+  if(jobDue(&ntpJob, currentTime))
     needRedraw |= ntpSyncTime();
-    lastNTPCheck = currentTime;
-  }
 
   // Tick EEPROM time, saving changes if the occurred and there has
   // been no activity for a while
@@ -926,9 +970,24 @@ void loop()
     background_timer = currentTime;
   }
 
-  // Redraw screen if necessary
-  if(needRedraw) drawScreen();
+  // Let the radio task work while drawing and waiting
+  radioUnlock();
+
+  // Redraw screen if necessary, after pending encoder input is applied
+  bool busy = drawTickTime(needRedraw, encoderPending());
+
+  // Keep polling while the button is pressed, a scan is running, or
+  // something is waiting to happen soon
+  busy |= pb1st.isPressed || digitalRead(ENCODER_PUSH_BUTTON) == LOW;
+  busy |= encoderPending() || scanIsRunning();
+#ifdef ENABLE_HOLDOFF
+  busy |= tuning_flag;
+#endif
 
-  // Add a small default delay in the main loop
-  delay(5);
+  // Otherwise, sleep until an event or the next periodic job
+  uint32_t wait = busy? MIN_ELAPSED_TIME : MAX_ELAPSED_TIME;
+  wait = jobWait(&rssiJob, millis(), wait);
+  wait = jobWait(&scheduleJob, millis(), wait);
+  wait = jobWait(&ntpJob, millis(), wait);
+  eventWait(wait);
 }
@@ -0,0 +1,213 @@
+//
+// Check that pushing changed screen tiles leaves the display exactly
+// like the screen buffer, pixel by pixel, and measure the comparison
+// time. Built with and without ENABLE_STRIPS.
+//
+
+#include "test.h"
+#include "Draw-Tiles.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES 2000
+
+#ifdef ENABLE_STRIPS
+#define STRIP_ROWS 2 // Rows of tiles per strip
+#else
+#define STRIP_ROWS TILES_Y
+#endif
+
+static size_t pixel;                 // Bytes per pixel
+static uint8_t screen[320 * 170 * 2]; // What is drawn
+static uint8_t display[320 * 170 * 2]; // What the display shows
+static uint8_t shown[320 * 170 * 2];  // Copy kept by tilesUpdate()
+static const uint8_t *strip;         // Strip being pushed
+static int stripTop;                 // First row of tiles in the strip
+static bool pushed[TILES_Y][TILES_X];
+static int pushes;
+
+//
+// Display side of a push: copy tiles from the strip to the display
+//
+static void push(int tx, int ty, int tw, int th)
+{
+  for(int y=ty*TILE_H ; y<(ty+th)*TILE_H ; y++)
+    memcpy(
+      display + (y * 320 + tx * TILE_W) * pixel,
+      strip + ((y - stripTop * TILE_H) * 320 + tx * TILE_W) * pixel,
+      tw * TILE_W * pixel
+    );
+
+  for(int y=ty ; y<ty+th ; y++)
+    for(int x=tx ; x<tx+tw ; x++) pushed[y][x] = true;
+
+  pushes++;
+}
+
+//
+// Push the screen strip by strip, return number of changed tiles
+//
+static int update(bool full, uint8_t *copy)
+{
+  int changed = 0;
+
+  memset(pushed, 0, sizeof(pushed));
+  pushes = 0;
+
+  for(stripTop=0 ; stripTop<TILES_Y ; stripTop+=STRIP_ROWS)
+  {
+    strip = screen + stripTop * TILE_H * 320 * pixel;
+    changed += tilesUpdate(strip, copy, pixel, stripTop, STRIP_ROWS, full, push);
+  }
+
+  return(changed);
+}
+
+//
+// Draw a filled rectangle with given pixel value
+//
+static void fill(int x, int y, int w, int h, uint32_t value)
+{
+  for(int j=y ; j<y+h && j<170 ; j++)
+    for(int i=x ; i<x+w && i<320 ; i++)
+      memcpy(screen + (j * 320 + i) * pixel, &value, pixel);
+}
+
+//
+// Make changes like the ones seen on the screen: a few rectangles,
+// single pixels, and pixel values moved around within a tile (which
+// keeps most checksums of the tile contents)
+//
+static void change()
+{
+  switch(testRandom(4))
+  {
+    case 0:
+      fill(testRandom(320), testRandom(170), 1 + testRandom(60), 1 + testRandom(30), testRandom(0x10000));
+      break;
+    case 1:
+      fill(testRandom(320), testRandom(170), 1, 1, testRandom(0x10000));
+      break;
+    case 2:
+    {
+      // Swap two pixels within a tile
+      int x = testRandom(TILES_X) * TILE_W, y = testRandom(TILES_Y) * TILE_H;
+      uint8_t *a = screen + ((y + testRandom(TILE_H)) * 320 + x + testRandom(TILE_W)) * pixel;
+      uint8_t *b = screen + ((y + testRandom(TILE_H)) * 320 + x + testRandom(TILE_W)) * pixel;
+      uint8_t t[2];
+      memcpy(t, a, pixel);
+      memcpy(a, b, pixel);
+      memcpy(b, t, pixel);
+      break;
+    }
+    case 3:
+      // Nothing changes
+      break;
+  }
+}
+
+//
+// Check that every changed tile has been pushed, that pushed tiles
+// only cover changed tiles and the columns between them, and that the
+// display is the same as the screen buffer
+//
+static bool checkPush(const uint8_t *before)
+{
+  for(int ty=0 ; ty<TILES_Y ; ty++)
+  {
+    int first = TILES_X, last = -1;
+
+    for(int tx=0 ; tx<TILES_X ; tx++)
+    {
+      bool changed = false;
+      for(int y=ty*TILE_H ; y<(ty+1)*TILE_H && !changed ; y++)
+        changed = memcmp(
+          screen + (y * 320 + tx * TILE_W) * pixel,
+          before + (y * 320 + tx * TILE_W) * pixel,
+          TILE_W * pixel
+        );
+
+      if(changed && !pushed[ty][tx]) return(false);
+      if(changed) { first = tx < first? tx : first; last = tx; }
+    }
+
+    for(int tx=0 ; tx<TILES_X ; tx++)
+      if(pushed[ty][tx] && (tx < first || tx > last)) return(false);
+  }
+
+  return(!memcmp(display, screen, 320 * 170 * pixel));
+}
+
+static void testTiles(size_t size)
+{
+  static uint8_t before[320 * 170 * 2];
+
+  pixel = size;
+  memset(screen, 0, sizeof(screen));
+  memset(display, 0xFF, sizeof(display));
+
+  // First push is a full one
+  CHECK(update(true, shown) == TILES_X * TILES_Y);
+  CHECK(!memcmp(display, screen, 320 * 170 * pixel));
+  CHECK(!memcmp(shown, screen, 320 * 170 * pixel));
+
+  // Nothing changed, nothing pushed
+  CHECK(update(false, shown) == 0 && pushes == 0);
+
+  // Every tile corner is noticed
+  bool ok = true;
+  for(int ty=0 ; ty<TILES_Y ; ty++)
+    for(int tx=0 ; tx<TILES_X ; tx++)
+    {
+      memcpy(before, screen, sizeof(screen));
+      fill(tx * TILE_W + TILE_W - 1, ty * TILE_H + TILE_H - 1, 1, 1, 0x5A5A);
+      ok = ok && update(false, shown) == 1 && checkPush(before);
+    }
+  CHECK(ok);
+
+  // Random changes
+  ok = true;
+  for(int j=0 ; j<FRAMES ; j++)
+  {
+    memcpy(before, screen, sizeof(screen));
+    for(int k=testRandom(4) ; k>=0 ; k--) change();
+    update(false, shown);
+    ok = ok && checkPush(before);
+  }
+  CHECK(ok);
+
+  // Without a copy of the display, everything is pushed
+  fill(0, 0, 1, 1, 0x1234);
+  CHECK(update(false, 0) == TILES_X * TILES_Y);
+  CHECK(!memcmp(display, screen, 320 * 170 * pixel));
+}
+
+static void benchTiles(size_t size)
+{
+  pixel = size;
+  update(true, shown);
+
+  // Typical update: a few widgets change
+  double time = 0;
+  for(int j=0 ; j<FRAMES ; j++)
+  {
+    fill(250, 62, 60, 40, j);
+    fill(160, 135, 100, 16, j * 3);
+    double start = testTime();
+    update(false, shown);
+    time += testTime() - start;
+  }
+
+  printf("Tiles: %d-bit screen, %d tiles of %dx%d, %.1fus per update\n",
+    (int)size * 8, TILES_X * TILES_Y, TILE_W, TILE_H, time / FRAMES * 1e6);
+}
+
+int main()
+{
+  testTiles(1);
+  testTiles(2);
+  benchTiles(1);
+  benchTiles(2);
+  return(TEST_RESULT());
+}
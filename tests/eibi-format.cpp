@@ -0,0 +1,291 @@
+//
+// Check EiBi schedule parsing and the compact file format, and measure
+// parsing speed. Run with a path to eibi.txt to parse a real schedule,
+// otherwise a synthetic one of the same size is used.
+//
+
+#include "test.h"
+#include "EIBI-Format.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// About as many lines as in a seasonal eibi.txt
+#define LINES  12000
+#define PASSES 20
+
+//
+// Format a schedule line with frequency, time, and name in their columns
+//
+static int makeLine(char *buf, const char *freq, const char *time, const char *name)
+{
+  return(sprintf(buf, "%-14s%-9s%-11s%s\n", freq, time, " Mo-Fr ROU", name));
+}
+
+//
+// Parse a single line, return FALSE if it is not a schedule line
+//
+static bool parse(const char *text, StationSchedule *entry)
+{
+  char line[256];
+  int len = strlen(text);
+
+  memcpy(line, text, len + 1);
+  memset(entry, 0xAA, sizeof(*entry));
+  return(eibiParseChunk(line, len, entry));
+}
+
+static void testParse()
+{
+  StationSchedule entry;
+  char line[256];
+
+  // Plain line
+  makeLine(line, "6000", "0130-0245", "Radio Test International   ");
+  CHECK(parse(line, &entry));
+  CHECK(entry.freq == 6000);
+  CHECK(entry.start_h == 1 && entry.start_m == 30);
+  CHECK(entry.end_h == 2 && entry.end_m == 45);
+  CHECK(!strcmp(entry.name, "Radio Test International"));
+
+  // Leading white space, fractional frequency, CRLF, all day
+  line[0] = ' ';
+  makeLine(line + 1, "15770.5", "0000-2400", "WRMI\r");
+  CHECK(parse(line, &entry));
+  CHECK(entry.freq == 15770);
+  CHECK(entry.end_h == 24 && entry.end_m == 0);
+  CHECK(!strcmp(entry.name, "WRMI"));
+
+  // Accented characters are replaced, names cut to 24 characters
+  makeLine(line, "9420", "1800-1900", "R\xE9" "dio \xD1" "and\xFA" " Very Long Station Name");
+  CHECK(parse(line, &entry));
+  CHECK(!strcmp(entry.name, "Redio Nandu Very Long St"));
+
+  // Line without a name
+  CHECK(parse("153           0000-2400 Mo", &entry));
+  CHECK(entry.freq == 153 && !entry.name[0]);
+
+  // Not schedule lines
+  CHECK(!parse("kHz:75 Time(UTC):93 Days:59 ITU:49 Station:201", &entry));
+  CHECK(!parse("", &entry));
+  CHECK(!parse("6000          0130-02", &entry));
+  makeLine(line, "6000", "0130 0245", "Bad time");
+  CHECK(!parse(line, &entry));
+  makeLine(line, "6000", "01x0-0245", "Bad time");
+  CHECK(!parse(line, &entry));
+  makeLine(line, "99999", "0130-0245", "Too high");
+  CHECK(!parse(line, &entry));
+  makeLine(line, "6000", "0130-0245", "Jammer");
+  CHECK(!parse(line, &entry));
+}
+
+static bool sameEntry(const StationSchedule *a, const StationSchedule *b)
+{
+  return(
+    a->freq == b->freq && a->start_h == b->start_h && a->start_m == b->start_m &&
+    a->end_h == b->end_h && a->end_m == b->end_m && !strcmp(a->name, b->name)
+  );
+}
+
+//
+// Pack entries into a schedule file image, return its size
+//
+static size_t packFile(const StationSchedule *entries, int count, uint8_t *file, EibiNames *names)
+{
+  EibiHeader header = { EIBI_MAGIC, EIBI_VERSION, 0, sizeof(EibiHeader), sizeof(EibiRecord), 0, 0 };
+  EibiRecord *records = (EibiRecord *)(file + sizeof(EibiHeader));
+
+  for(int j = 0 ; j < count ; j++)
+    eibiPack(&entries[j], &records[header.count++], names);
+
+  header.names     = EIBI_RECORD_POS(header.count);
+  header.namesSize = names->size;
+  memcpy(file, &header, sizeof(header));
+  memcpy(file + header.names, names->names, names->size);
+  return(header.names + header.namesSize);
+}
+
+//
+// Unpack a record from a schedule file image, the way the firmware reads it
+//
+static void unpackFile(const uint8_t *file, int rec, StationSchedule *entry)
+{
+  const EibiHeader *header = (const EibiHeader *)file;
+  const EibiRecord *record = (const EibiRecord *)(file + EIBI_RECORD_POS(rec));
+  size_t size = record->name < header->namesSize? header->namesSize - record->name : 0;
+
+  eibiUnpack(record, file + header->names + record->name, size, entry);
+}
+
+static void testFormat()
+{
+  static const StationSchedule entries[] =
+  {
+    {   153,  0,  0, 24,  0, "Antena Satelor" },
+    {  6000,  1, 30,  2, 45, "Radio Test International" },
+    {  6000, 22,  0,  1, 59, "Radio Test International" },
+    {  9420, -1, -1, -1, -1, "Any time" },
+    { 15770, 12,  0, 13,  0, "" },
+    { 65535, 23, 59,  0,  0, "1234567890123456789012345678901" },
+  };
+  const int count = sizeof(entries) / sizeof(entries[0]);
+  uint8_t file[1024];
+  EibiNames names;
+
+  CHECK(sizeof(EibiHeader) == 20);
+  CHECK(sizeof(EibiRecord) == 8);
+
+  // Entries come back as they were packed, same names are stored once
+  CHECK(eibiNamesInit(&names));
+  size_t size = packFile(entries, count, file, &names);
+  CHECK(!names.failed && !names.dropped && names.count == count - 1);
+  CHECK(size == EIBI_RECORD_POS(count) + names.size);
+
+  const EibiRecord *records = (const EibiRecord *)(file + sizeof(EibiHeader));
+  CHECK(records[1].name == records[2].name);
+  CHECK(records[3].start == EIBI_ANY && records[3].end == EIBI_ANY);
+
+  bool ok = true;
+  for(int j = 0 ; j < count ; j++)
+  {
+    StationSchedule entry;
+    unpackFile(file, j, &entry);
+    ok = ok && sameEntry(&entry, &entries[j]);
+  }
+  CHECK(ok);
+
+  // Record without a name
+  StationSchedule entry;
+  EibiRecord noName = { 7000, 60, 120, EIBI_NO_NAME };
+  eibiUnpack(&noName, 0, 0, &entry);
+  CHECK(entry.freq == 7000 && entry.start_h == 1 && entry.end_h == 2 && !entry.name[0]);
+
+  // Header is checked against the format and the file size
+  EibiHeader *header = (EibiHeader *)file;
+  EibiHeader saved = *header;
+  CHECK(eibiCheckHeader(header, size));
+  CHECK(!eibiCheckHeader(header, size - 1));
+  header->version = 1;
+  CHECK(!eibiCheckHeader(header, size));
+  *header = saved;
+  header->magic ^= 1;
+  CHECK(!eibiCheckHeader(header, size));
+  *header = saved;
+  header->headerSize = 16;
+  CHECK(!eibiCheckHeader(header, size));
+  *header = saved;
+  header->recordSize = 40;
+  CHECK(!eibiCheckHeader(header, size));
+  *header = saved;
+  header->count++;
+  CHECK(!eibiCheckHeader(header, size));
+  *header = saved;
+
+  // Version 1 header (no sizes) is rejected
+  uint8_t old[20] = { 0x45, 0x49, 0x42, 0x49, 1, 0, 6, 0, 64, 0, 0, 0, 100, 0, 0, 0 };
+  CHECK(!eibiCheckHeader((const EibiHeader *)old, sizeof(old) + 200));
+
+  eibiNamesFree(&names);
+}
+
+//
+// Make an eibi.txt-sized schedule text
+//
+static char *makeText(size_t *size)
+{
+  static const char *words[] = { "Radio", "Voice", "Int.", "Free", "Asia", "Africa", "Nacional", "Mundial" };
+  char *text = (char *)malloc(LINES * 128);
+  char *p = text;
+
+  p += sprintf(p, "kHz:75 Time(UTC):93 Days:59 ITU:49 Station:201 Lng:49 Target:62\n");
+  for(int j = 0 ; j < LINES ; j++)
+  {
+    char freq[16], time[16], name[64];
+    int start = testRandom(24 * 4) * 15;
+    int end = start + 15 * (1 + testRandom(16));
+
+    sprintf(freq, "%u", 150 + testRandom(30000 - 150));
+    sprintf(time, "%02d%02d-%02d%02d", start / 60, start % 60, end / 60 % 24, end % 60);
+    sprintf(name, "%s %s %s", words[testRandom(8)], words[testRandom(8)], words[testRandom(8)]);
+    p += makeLine(p, freq, time, name);
+  }
+
+  *size = p - text;
+  return(text);
+}
+
+//
+// Read schedule text from given file
+//
+static char *readText(const char *path, size_t *size)
+{
+  FILE *f = fopen(path, "rb");
+  char *text = 0;
+
+  if(!f) return(0);
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  text = (char *)malloc(*size + 1);
+  if(fread(text, 1, *size, f) != *size) { free(text); text = 0; }
+  fclose(f);
+  return(text);
+}
+
+//
+// Parse schedule text line by line, like the loader task does
+//
+static int parseText(char *text, size_t size)
+{
+  StationSchedule entry;
+  char *line = text;
+  char *end  = text + size;
+  char *eol;
+  int count = 0;
+
+  while((eol = (char *)memchr(line, '\n', end - line)))
+  {
+    count += eibiParseChunk(line, eol - line, &entry);
+    line = eol + 1;
+  }
+
+  return(count);
+}
+
+static void benchParse(const char *path)
+{
+  size_t size;
+  char *text = path? readText(path, &size) : makeText(&size);
+
+  CHECK(text);
+  if(!text) return;
+
+  // Parsing modifies lines in place, parse a fresh copy every time
+  char *copy = (char *)malloc(size);
+  int count = 0;
+  double time = 0;
+
+  for(int j = 0 ; j < PASSES ; j++)
+  {
+    memcpy(copy, text, size);
+    double start = testTime();
+    count = parseText(copy, size);
+    time += testTime() - start;
+  }
+
+  CHECK(count > 0);
+  printf("Parse: %u bytes, %d entries from %s\n", (unsigned)size, count, path? path : "synthetic schedule");
+  printf("Parse: %.0f entries per second, %.1f MB per second\n",
+    count * PASSES / time, size * PASSES / time / 1e6);
+
+  free(copy);
+  free(text);
+}
+
+int main(int argc, char **argv)
+{
+  testParse();
+  testFormat();
+  benchParse(argc > 1? argv[1] : 0);
+  return(TEST_RESULT());
+}
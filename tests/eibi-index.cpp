@@ -0,0 +1,235 @@
+//
+// Check EiBi schedule index against a brute force search over an
+// EiBi-sized synthetic schedule, and measure lookup speed
+//
+
+#include "test.h"
+#include "EIBI-Index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// About as many records and frequencies as in a seasonal eibi.txt
+#define RECORDS 12000
+#define LOOKUPS 2000000
+
+static EibiRecord records[RECORDS];
+static size_t total = 0;
+static uint32_t reads = 0;
+
+static bool readRecords(size_t rec, EibiRecord *buf, size_t n)
+{
+  if(rec + n > total) return(false);
+  memcpy(buf, records + rec, n * sizeof(EibiRecord));
+  reads++;
+  return(true);
+}
+
+static int compareRecords(const void *a, const void *b)
+{
+  const EibiRecord *x = (const EibiRecord *)a;
+  const EibiRecord *y = (const EibiRecord *)b;
+
+  if(x->freq != y->freq) return(x->freq - y->freq);
+  if(x->start != y->start) return(x->start - y->start);
+  return(x->end - y->end);
+}
+
+//
+// Make a schedule sorted by frequency and time, like an imported one:
+// transmissions mostly start at quarter hours and last up to a few
+// hours, some go on all day, some cross midnight
+//
+static void makeSchedule()
+{
+  for(total = 0 ; total < RECORDS ; total++)
+  {
+    EibiRecord *rec = &records[total];
+
+    // Reuse a recent frequency for about two thirds of the records
+    if(total && testRandom(3)) rec->freq = records[total - 1 - testRandom(total < 8? total : 8)].freq;
+    else rec->freq = 150 + testRandom(30000 - 150);
+
+    if(!testRandom(20))
+    {
+      rec->start = 0;
+      rec->end   = EIBI_DAY;
+    }
+    else if(testRandom(5))
+    {
+      rec->start = testRandom(24 * 4) * 15;
+      rec->end   = (rec->start + 15 * (1 + testRandom(16)) - 1) % EIBI_DAY;
+    }
+    else
+    {
+      rec->start = testRandom(EIBI_DAY);
+      rec->end   = testRandom(EIBI_DAY);
+    }
+
+    rec->name = total;
+  }
+
+  qsort(records, total, sizeof(EibiRecord), compareRecords);
+}
+
+//
+// Return the first record at frequency of REC on the air at NOW
+//
+static int bruteFindNow(size_t rec, int now)
+{
+  for(size_t j = rec ; j < total && records[j].freq == records[rec].freq ; j++)
+    if(eibiIsNow(&records[j], now)) return(j);
+  return(-1);
+}
+
+//
+// Check the on-air table at NOW against a brute force search
+//
+static bool checkNow(int now)
+{
+  int pos = 0;
+
+  for(size_t rec = 0 ; rec < total ; rec++)
+  {
+    // Only look at the first record of each frequency
+    if(rec && records[rec].freq == records[rec - 1].freq) continue;
+
+    int found = bruteFindNow(rec, now);
+    if(found < 0) continue;
+
+    if(pos >= eibiNowSize() || eibiNowFreq(pos) != records[rec].freq || (int)eibiNowRecord(pos) != found)
+      return(false);
+    pos++;
+  }
+
+  return(pos == eibiNowSize());
+}
+
+static void testIndex()
+{
+  int freqs = 0;
+
+  for(size_t rec = 0 ; rec < total ; rec++)
+    freqs += !rec || records[rec].freq != records[rec - 1].freq;
+
+  CHECK(eibiIndexBuild(total, readRecords));
+  CHECK(eibiIndexCount() == freqs);
+  CHECK(eibiIndexFirst(eibiIndexCount()) == total);
+
+  // Every record belongs to its frequency
+  bool ok = true;
+  for(size_t rec = 0 ; rec < total ; rec++)
+  {
+    int idx = eibiIndexFind(rec);
+    ok = ok && eibiIndexFreq(idx) == records[rec].freq &&
+         eibiIndexFirst(idx) <= rec && rec < eibiIndexFirst(idx + 1);
+  }
+  CHECK(ok);
+
+  // Records on the air are found at every frequency
+  ok = true;
+  for(size_t rec = 0 ; rec < total ; rec += 7)
+  {
+    EibiRecord found;
+    int now = testRandom(EIBI_DAY);
+    int idx = eibiIndexFind(rec);
+    int expected = bruteFindNow(rec, now);
+    ok = ok && eibiIndexFindNow(idx, rec, now, &found) == expected &&
+         (expected < 0 || found.name == records[expected].name);
+  }
+  CHECK(ok);
+
+  // On-air table for all minutes of the day
+  ok = true;
+  for(int now = 0 ; now < EIBI_DAY ; now++)
+  {
+    eibiNowUpdate(now);
+    ok = ok && checkNow(now);
+  }
+  CHECK(ok);
+
+  // On-air table after jumps of up to an hour, across midnight
+  ok = true;
+  for(int now = 0, j = 0 ; j < 500 ; j++)
+  {
+    now = (now + 1 + testRandom(60)) % EIBI_DAY;
+    eibiNowUpdate(now);
+    ok = ok && checkNow(now);
+  }
+  CHECK(ok);
+
+  // Clock going back
+  eibiNowUpdate(600);
+  eibiNowUpdate(300);
+  CHECK(checkNow(300));
+
+  // Empty schedule has nothing to index
+  CHECK(!eibiIndexBuild(0, readRecords));
+  CHECK(eibiIndexCount() == 0);
+}
+
+//
+// Measure flash reads needed to keep the on-air table current
+//
+static void benchUpdate()
+{
+  uint32_t full, incremental = 0, updates = 0;
+
+  CHECK(eibiIndexBuild(total, readRecords));
+
+  // Building the table from scratch reads the whole schedule
+  reads = 0;
+  eibiNowUpdate(0);
+  full = reads;
+
+  // Follow the clock through the day
+  for(int now = 1 ; now < EIBI_DAY ; now++)
+  {
+    reads = 0;
+    eibiNowUpdate(now);
+    incremental += reads;
+    updates += !!reads;
+  }
+
+  CHECK(updates > 0 && incremental / updates < full);
+  printf("Updates: %u reads to build, %u reads per update, %u updates per day\n",
+    full, updates? incremental / updates : 0, updates);
+}
+
+static void benchLookup()
+{
+  uint32_t found = 0;
+
+  CHECK(eibiIndexBuild(total, readRecords));
+  eibiNowUpdate(12 * 60);
+
+  // Look up random frequencies, half of them on the air
+  uint16_t *freqs = (uint16_t *)malloc(LOOKUPS * sizeof(uint16_t));
+  for(int j = 0 ; j < LOOKUPS ; j++)
+    freqs[j] = j & 1? 150 + testRandom(30000 - 150) : eibiNowFreq(testRandom(eibiNowSize()));
+
+  reads = 0;
+  double time = testTime();
+  for(int j = 0 ; j < LOOKUPS ; j++)
+  {
+    int pos = eibiNowFind(freqs[j]);
+    found += pos < eibiNowSize() && eibiNowFreq(pos) == freqs[j];
+  }
+  time = testTime() - time;
+
+  CHECK(found >= LOOKUPS / 2);
+  CHECK(reads == 0);
+  printf("Lookups: %u records, %d frequencies, %d on the air\n", (unsigned)total, eibiIndexCount(), eibiNowSize());
+  printf("Lookups: %.0f per second, %u flash reads\n", LOOKUPS / time, reads);
+  free(freqs);
+}
+
+int main()
+{
+  makeSchedule();
+  testIndex();
+  benchUpdate();
+  benchLookup();
+  eibiIndexFree();
+  return(TEST_RESULT());
+}
@@ -0,0 +1,155 @@
+//
+// Replay encoder detent traces through the queue and check the
+// resulting tuning steps, acceleration, and queue overflow.
+//
+
+#include "test.h"
+#include "Encoder.h"
+
+#include <string.h>
+
+typedef struct
+{
+  uint32_t interval;      // Msecs since the previous detent
+  int8_t dir;             // +1 or -1
+} Detent;
+
+static EncoderQueue queue;
+static uint32_t now;
+
+static void reset(uint32_t start)
+{
+  memset(&queue, 0, sizeof(queue));
+  now = start;
+}
+
+//
+// Queue detents from TRACE, then drain them at once
+//
+static int replay(const Detent *trace, int count, bool accel)
+{
+  for(int j = 0 ; j < count ; j++)
+  {
+    now += trace[j].interval;
+    encoderQueuePush(&queue, now, trace[j].dir);
+  }
+
+  return(encoderQueueDrain(&queue, accel));
+}
+
+static void testSlow()
+{
+  static const Detent trace[] = { { 500, 1 }, { 150, 1 }, { 100, 1 } };
+
+  // Slow turns make single steps
+  reset(1000);
+  CHECK(replay(trace, 3, true) == 3);
+  CHECK(!encoderQueuePending(&queue));
+}
+
+static void testSpin()
+{
+  // Average time between detents and steps for a 5ms spin
+  static const uint32_t speeds[] = { 100, 76, 58, 44, 34, 26, 20, 16, 13, 11 };
+  static const int steps[]       = {   1,  1,  1,  1,  2,  2,  2,  4,  4,  8 };
+  static const Detent detent     = { 5, -1 };
+  bool ok = true;
+
+  // Drained detent by detent
+  reset(1000);
+  for(int j = 0 ; j < 10 ; j++)
+  {
+    int result = replay(&detent, 1, true);
+    ok = ok && queue.speed == speeds[j] && result == -steps[j];
+  }
+  CHECK(ok);
+
+  // Same steps when drained at once, or without acceleration
+  Detent trace[10];
+  for(int j = 0 ; j < 10 ; j++) trace[j] = detent;
+  reset(1000);
+  CHECK(replay(trace, 10, true) == -26);
+  reset(1000);
+  CHECK(replay(trace, 10, false) == -10);
+
+  // Spinning across the millis() wraparound
+  reset(0xFFFFFFFFu - 20);
+  CHECK(replay(trace, 10, true) == -26);
+}
+
+static void testReset()
+{
+  static const Detent spin[] = { { 5, 1 }, { 5, 1 }, { 5, 1 }, { 5, 1 }, { 5, 1 }, { 5, 1 }, { 5, 1 }, { 5, 1 } };
+  static const Detent back[] = { { 5, -1 } };
+  static const Detent pause[] = { { ENCODER_ACCEL_RESET, 1 } };
+
+  // Direction change starts over
+  reset(1000);
+  CHECK(replay(spin, 8, true) == 1 + 1 + 1 + 1 + 2 + 2 + 2 + 4);
+  CHECK(replay(back, 1, true) == -1 && queue.speed == ENCODER_ACCEL_RESET);
+
+  // Pause starts over
+  reset(1000);
+  replay(spin, 8, true);
+  CHECK(replay(pause, 1, true) == 1 && queue.speed == ENCODER_ACCEL_RESET);
+}
+
+static void testOverflow()
+{
+  static const Detent detent = { 200, 1 };
+
+  // Queue keeps one slot empty, detents beyond that are dropped
+  reset(1000);
+  for(int j = 0 ; j < ENCODER_QUEUE_SIZE + 10 ; j++)
+  {
+    now += detent.interval;
+    encoderQueuePush(&queue, now, detent.dir);
+  }
+  CHECK(encoderQueuePending(&queue));
+  CHECK(encoderQueueDrain(&queue, true) == ENCODER_QUEUE_SIZE - 1);
+  CHECK(!encoderQueuePending(&queue));
+
+  // Queue works after wrapping around
+  CHECK(replay(&detent, 1, true) == 1);
+}
+
+//
+// A long spin makes the same steps no matter how many detents pile up
+// between main loop iterations
+//
+static void testLoop()
+{
+  Detent trace[200];
+  int total = 0, drained = 0;
+
+  for(int j = 0 ; j < 200 ; j++)
+  {
+    trace[j].interval = 3 + testRandom(40);
+    trace[j].dir = j < 120? 1 : -1;
+  }
+
+  reset(1000);
+  for(int j = 0 ; j < 200 ; j++) total += replay(trace + j, 1, true);
+
+  reset(1000);
+  for(int j = 0 ; j < 200 ; )
+  {
+    int n = 1 + testRandom(ENCODER_QUEUE_SIZE - 1);
+    n = n < 200 - j? n : 200 - j;
+    drained += replay(trace + j, n, true);
+    j += n;
+  }
+
+  CHECK(drained == total);
+  printf("Encoder: 200 detents make %d steps\n", total);
+}
+
+int main()
+{
+  testSlow();
+  testSpin();
+  testReset();
+  testOverflow();
+  testLoop();
+  return(TEST_RESULT());
+}
@@ -0,0 +1,107 @@
+//
+// Check periodic job deadlines with a simulated clock, including the
+// millis() wraparound, and run a simulated main loop that sleeps until
+// the next deadline or an early event.
+//
+
+#include "test.h"
+#include "Jobs.h"
+
+// Simulated time, crossing the wraparound
+#define LOOP_START  (0xFFFFFFFFu - 300000u)
+#define LOOP_TIME   600000u
+#define LOOP_WAIT   1000u // Longest main loop sleep
+
+static void testDue()
+{
+  Job job = { 200, 1000 };
+
+  // Due once per period, starting over from the time it ran
+  CHECK(!jobDue(&job, 1000));
+  CHECK(!jobDue(&job, 1199));
+  CHECK(jobDue(&job, 1200) && job.last == 1200);
+  CHECK(!jobDue(&job, 1300));
+
+  // Late runs are not made up for
+  CHECK(jobDue(&job, 2000) && job.last == 2000);
+  CHECK(!jobDue(&job, 2100));
+
+  // Wait until due, no more than asked for
+  CHECK(jobWait(&job, 2000, 1000) == 200);
+  CHECK(jobWait(&job, 2150, 1000) == 50);
+  CHECK(jobWait(&job, 2150, 10) == 10);
+  CHECK(jobWait(&job, 2200, 1000) == 0);
+  CHECK(jobWait(&job, 5000, 1000) == 0);
+}
+
+static void testWrap()
+{
+  Job job = { 200, 0xFFFFFFF0u };
+
+  // Deadline is past the wraparound
+  CHECK(jobWait(&job, 0xFFFFFFF0u, 1000) == 200);
+  CHECK(jobWait(&job, 0xFFFFFFFFu, 1000) == 185);
+  CHECK(!jobDue(&job, 0xFFFFFFFFu));
+  CHECK(jobWait(&job, 100, 1000) == 84);
+  CHECK(!jobDue(&job, 183));
+  CHECK(jobWait(&job, 183, 1000) == 1);
+  CHECK(jobDue(&job, 184) && job.last == 184);
+  CHECK(jobWait(&job, 184, 1000) == 200);
+
+  // Job that last ran before the wraparound and is overdue
+  job.last = 0xFFFFFF00u;
+  CHECK(jobWait(&job, 1000, 1000) == 0);
+  CHECK(jobDue(&job, 1000) && job.last == 1000);
+}
+
+//
+// Main loop: run due jobs, then sleep until the next deadline, or
+// less if an event comes first. Every job has to run exactly at its
+// deadline, no earlier and no later.
+//
+static void testLoop()
+{
+  // Periods used by the firmware
+  Job jobs[] = { { 200, LOOP_START }, { 250, LOOP_START }, { 2000, LOOP_START }, { 60000, LOOP_START } };
+  const int count = sizeof(jobs) / sizeof(jobs[0]);
+  uint32_t runs[count] = { 0 };
+  uint32_t now = LOOP_START;
+  uint32_t wakeups = 0;
+  bool ok = true;
+
+  for(uint32_t elapsed = 0 ; elapsed <= LOOP_TIME ; )
+  {
+    for(int j = 0 ; j < count ; j++)
+    {
+      uint32_t last = jobs[j].last;
+      if(!jobDue(&jobs[j], now)) continue;
+      ok = ok && now - last == jobs[j].period;
+      runs[j]++;
+    }
+
+    uint32_t wait = LOOP_WAIT;
+    for(int j = 0 ; j < count ; j++) wait = jobWait(&jobs[j], now, wait);
+    ok = ok && wait > 0;
+
+    // Encoder, serial or other events wake the loop early
+    if(testRandom(4) == 0) wait = testRandom(wait + 1);
+
+    now += wait;
+    elapsed += wait;
+    wakeups++;
+  }
+
+  CHECK(ok);
+  for(int j = 0 ; j < count ; j++)
+    CHECK(runs[j] == LOOP_TIME / jobs[j].period);
+
+  printf("Jobs: %u wakeups in %us of simulated time\n", (unsigned)wakeups, LOOP_TIME / 1000);
+}
+
+int main()
+{
+  testDue();
+  testWrap();
+  testLoop();
+  return(TEST_RESULT());
+}
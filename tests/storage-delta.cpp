@@ -0,0 +1,136 @@
+//
+// Check that settings saves only write and commit changed bytes, using
+// a simulated flash that, like NVS under the EEPROM library, appends
+// the whole EEPROM blob to a page on every commit and erases pages as
+// they are reused. Counts page erases for a series of saves.
+//
+
+#include "test.h"
+#include "Storage.h"
+#include "Storage-Delta.h"
+
+#include <string.h>
+
+#define SAVES       1000
+#define FLASH_PAGE  4096 // Flash page size (bytes)
+#define BLOB_SIZE   (EEPROM_SIZE + 32) // Blob and its entry header
+
+static uint8_t eeprom[EEPROM_SIZE];  // EEPROM library RAM buffer
+static uint8_t flash[EEPROM_SIZE];   // Last blob written to flash
+static bool dirty;
+static int written;                  // Bytes written since last commit
+static int commits;
+static int erases;
+static int pageUsed = FLASH_PAGE;    // Bytes used in the current page
+
+static void writeByte(int addr, uint8_t data)
+{
+  eeprom[addr] = data;
+  dirty = true;
+  written++;
+}
+
+//
+// Commit EEPROM buffer to the simulated flash, if changed
+//
+static void commit()
+{
+  if(!dirty) return;
+
+  if(pageUsed + BLOB_SIZE > FLASH_PAGE)
+  {
+    erases++;
+    pageUsed = 0;
+  }
+
+  pageUsed += BLOB_SIZE;
+  memcpy(flash, eeprom, sizeof(flash));
+  dirty = false;
+  commits++;
+}
+
+//
+// Save BUF the way eepromCommit() does it
+//
+static bool save(const uint8_t *buf, uint8_t *image)
+{
+  written = 0;
+  if(!memcmp(buf, image, EEPROM_SIZE)) return(false);
+  int bytes = storageUpdate(buf, image, EEPROM_SIZE, writeByte);
+  commit();
+  return(bytes > 0);
+}
+
+static void testUpdate()
+{
+  static uint8_t buf[EEPROM_SIZE], image[EEPROM_SIZE];
+
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  memset(image, 0xFF, sizeof(image));
+  memcpy(buf, image, sizeof(buf));
+  commits = 0;
+
+  // Nothing changed, nothing written or committed
+  CHECK(!save(buf, image) && !written && !commits);
+
+  // Only changed bytes are written, once
+  buf[0] = 1;
+  buf[EEPROM_SIZE - 1] = 2;
+  CHECK(save(buf, image) && written == 2 && commits == 1);
+  CHECK(!memcmp(flash, buf, sizeof(buf)) && !memcmp(image, buf, sizeof(buf)));
+
+  // Same contents again
+  CHECK(!save(buf, image) && !written && commits == 1);
+}
+
+//
+// Save settings like a user does: most saves change a byte or two
+// (volume, frequency), some change nothing
+//
+static void benchSaves()
+{
+  static uint8_t buf[EEPROM_SIZE], image[EEPROM_SIZE];
+  int changes = 0;
+  bool ok = true;
+
+  memset(eeprom, 0, sizeof(eeprom));
+  memset(flash, 0, sizeof(flash));
+  memset(image, 0, sizeof(image));
+  memset(buf, 0, sizeof(buf));
+  commits = erases = 0;
+  pageUsed = FLASH_PAGE;
+
+  for(int j = 0 ; j < SAVES ; j++)
+  {
+    bool changed = false;
+
+    if(testRandom(3))
+      for(int k = testRandom(4) ; k >= 0 ; k--)
+      {
+        uint8_t *p = &buf[testRandom(EEPROM_SIZE)];
+        uint8_t v = testRandom(256);
+        changed |= *p != v;
+        *p = v;
+      }
+
+    changes += changed;
+    save(buf, image);
+    ok = ok && !memcmp(flash, buf, sizeof(buf));
+  }
+
+  CHECK(ok);
+  CHECK(commits == changes);
+
+  // Committing on every save, as before, fills a page every
+  // FLASH_PAGE / BLOB_SIZE saves
+  int before = (SAVES + FLASH_PAGE / BLOB_SIZE - 1) / (FLASH_PAGE / BLOB_SIZE);
+  printf("Storage: %d saves, %d commits, %d page erases (%d when committing every save)\n",
+    SAVES, commits, erases, before);
+}
+
+int main()
+{
+  testUpdate();
+  benchSaves();
+  return(TEST_RESULT());
+}
@@ -0,0 +1,42 @@
+#ifndef TEST_H
+#define TEST_H
+
+//
+// Minimal host test harness. Each test is a program that checks
+// conditions with CHECK(), prints measurements, and returns the number
+// of failed checks from main() via TEST_RESULT().
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int testFailed = 0;
+
+#define CHECK(cond) \
+  do { if(!(cond)) { printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); testFailed++; } } while(0)
+
+#define TEST_RESULT() \
+  (printf("%s: %s\n", __FILE__, testFailed? "FAILED" : "OK"), testFailed? 1 : 0)
+
+//
+// Return current time in seconds, for benchmarks
+//
+static inline double testTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+//
+// Repeatable pseudo-random numbers, so that failures can be reproduced
+//
+static uint32_t testSeed = 12345;
+static inline uint32_t testRandom(uint32_t range)
+{
+  testSeed = testSeed * 1103515245u + 12345u;
+  return((testSeed >> 8) % range);
+}
+
+#endif // TEST_H
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Serve a saved EiBi schedule to the receiver, to test schedule loading
+without downloading it from the EiBi site every time.
+
+The schedule is served with ETag and Last-Modified headers, answering
+conditional requests with "304 Not Modified" while the file does not
+change. Every request is logged with the validators the receiver sent
+and the reply. Example:
+
+    ./tools/eibi-server.py --port 8000 /tmp/eibi.txt
+
+Build the firmware with EIBI_URL pointing at this machine:
+
+    arduino-cli compile --build-property \\
+      'compiler.cpp.extra_flags=-DEIBI_URL="http://192.168.1.10:8000/eibi.txt"' \\
+      --clean -e -p COM_PORT -u ats-mini
+
+Then use the "Load EiBi" menu item and check the log:
+
+  * the first load gets the full file (200), the receiver converts it;
+  * loading again gets 304, the receiver shows "Schedule is up to date";
+  * after editing the file (or touching it), the next load gets 200;
+  * with --no-validators, every load gets the full file, and an unchanged
+    file is recognized by its content hash ("Schedule is up to date"
+    without sorting).
+"""
+
+import argparse
+import email.utils
+import hashlib
+import http.server
+import os
+import sys
+
+
+class ScheduleHandler(http.server.BaseHTTPRequestHandler):
+    path_name = None
+    validators = True
+
+    def do_GET(self):
+        with open(self.path_name, "rb") as f:
+            data = f.read()
+
+        mtime = int(os.stat(self.path_name).st_mtime)
+        etag = '"' + hashlib.sha1(data).hexdigest()[:16] + '"'
+        modified = email.utils.formatdate(mtime, usegmt=True)
+
+        sent_etag = self.headers.get("If-None-Match")
+        sent_modified = self.headers.get("If-Modified-Since")
+        self.log_message("If-None-Match: %s, If-Modified-Since: %s", sent_etag, sent_modified)
+
+        # ETag takes precedence over the date, as in RFC 9110
+        not_modified = False
+        if self.validators and sent_etag is not None:
+            not_modified = sent_etag == etag
+        elif self.validators and sent_modified is not None:
+            try:
+                since = email.utils.parsedate_to_datetime(sent_modified).timestamp()
+                not_modified = mtime <= since
+            except (TypeError, ValueError):
+                pass
+
+        if not_modified:
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            self.end_headers()
+            return
+
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(data)))
+        if self.validators:
+            self.send_header("ETag", etag)
+            self.send_header("Last-Modified", modified)
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serve a saved EiBi schedule with HTTP validators.")
+    parser.add_argument("schedule", help="saved eibi.txt file")
+    parser.add_argument("--port", type=int, default=8000, help="port to listen on (default: 8000)")
+    parser.add_argument(
+        "--no-validators", action="store_true", help="do not send ETag and Last-Modified, always send the file"
+    )
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.schedule):
+        sys.exit(f"No such file: {args.schedule}")
+
+    ScheduleHandler.path_name = args.schedule
+    ScheduleHandler.validators = not args.no_validators
+
+    server = http.server.HTTPServer(("", args.port), ScheduleHandler)
+    print(f"Serving {args.schedule} on port {args.port}, press Ctrl+C to stop")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Decode ATS Mini binary screenshots to PNG or BMP images.
+
+The receiver sends a binary screenshot in response to the "c" serial
+command, and a screenshot of the rows changed since the last capture
+in response to "d". Example (change the serial port name as needed):
+
+    echo -n c | socat stdio /dev/cu.usbmodem14401,echo=0,raw > /tmp/capture.bin
+    ./tools/screenshot.py /tmp/capture.bin /tmp/screenshot.png
+
+A capture file may contain several screenshots in a row (i.e. "cdd").
+Each of them is saved as a separate numbered image in that case.
+
+Screenshot format, all numbers little-endian:
+
+    "ATSC", version (1 byte), flags (1 byte, bit 0 = delta),
+    width (2 bytes), height (2 bytes), then for each row from the top:
+      0 - row is the same as in the previous screenshot
+      1 - row follows as packets, each starting with a byte N:
+            N & 0x80 - (N & 0x7F) + 1 copies of the following pixel
+            else     - N + 1 pixels follow
+    Pixels are RGB565, 2 bytes each.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+
+def decode(data):
+    """Yield (width, height, rows of RGB565 pixels) for each screenshot."""
+    pos = 0
+    rows = None
+
+    while pos < len(data):
+        if data[pos : pos + 4] != b"ATSC":
+            raise ValueError(f"No screenshot header at offset {pos}")
+        version, flags, width, height = struct.unpack_from("<BBHH", data, pos + 4)
+        if version != 1:
+            raise ValueError(f"Unsupported screenshot version {version}")
+        pos += 10
+
+        if flags & 1 and (rows is None or len(rows) != height):
+            raise ValueError("Delta screenshot without a previous one")
+        if rows is None or len(rows) != height:
+            rows = [[0] * width for _ in range(height)]
+
+        for y in range(height):
+            tag = data[pos]
+            pos += 1
+            if tag == 0:
+                continue
+            row = []
+            while len(row) < width:
+                n = data[pos]
+                pos += 1
+                if n & 0x80:
+                    (pixel,) = struct.unpack_from("<H", data, pos)
+                    row += [pixel] * ((n & 0x7F) + 1)
+                    pos += 2
+                else:
+                    row += struct.unpack_from(f"<{n + 1}H", data, pos)
+                    pos += (n + 1) * 2
+            rows[y] = row[:width]
+
+        yield width, height, [list(r) for r in rows]
+
+
+def rgb888(pixel):
+    r = (pixel >> 11) & 0x1F
+    g = (pixel >> 5) & 0x3F
+    b = pixel & 0x1F
+    return bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+
+def save_png(name, width, height, rows):
+    def chunk(kind, body):
+        crc = zlib.crc32(kind + body) & 0xFFFFFFFF
+        return struct.pack(">I", len(body)) + kind + body + struct.pack(">I", crc)
+
+    raw = b"".join(b"\0" + b"".join(rgb888(p) for p in row) for row in rows)
+    with open(name, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(raw, 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def save_bmp(name, width, height, rows):
+    stride = (width * 3 + 3) & ~3
+    pad = b"\0" * (stride - width * 3)
+    with open(name, "wb") as f:
+        f.write(b"BM" + struct.pack("<IHHI", 54 + stride * height, 0, 0, 54))
+        f.write(struct.pack("<IiiHHIIiiII", 40, width, height, 1, 24, 0, 0, 0, 0, 0, 0))
+        for row in reversed(rows):
+            f.write(b"".join(rgb888(p)[::-1] for p in row) + pad)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode ATS Mini binary screenshots")
+    parser.add_argument("capture", help="binary capture file, - for stdin")
+    parser.add_argument("image", help="output image file (.png or .bmp)")
+    args = parser.parse_args()
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+
+    save = save_bmp if args.image.lower().endswith(".bmp") else save_png
+    frames = list(decode(data))
+    if not frames:
+        sys.exit("No screenshots found")
+
+    for n, (width, height, rows) in enumerate(frames, 1):
+        name = args.image
+        if len(frames) > 1:
+            base, dot, ext = args.image.rpartition(".")
+            name = f"{base}-{n}.{ext}" if dot else f"{args.image}-{n}"
+        save(name, width, height, rows)
+        print(name)
+
+
+if __name__ == "__main__":
+    main()